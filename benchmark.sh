@@ -1,6 +1,15 @@
 #!/bin/bash
+# Usage: benchmark.sh [<camera path> [<rasterizer>]]
+# With a camera path, runs the headless benchmark and writes benchmark.json;
+# otherwise counts the instructions of a fixed number of interactive ticks.
 
 scons -Q -j 20
-if [ $? -eq 0 ]; then
+if [ $? -ne 0 ]; then
+  exit 1
+fi
+if [ -n "$1" ]; then
+  build/Release/renderer --benchmark "$1" --rasterizer "${2:-tiled}" \
+    --output benchmark.json
+else
   (perf stat build/Release/renderer --maxticks 512) 2>&1 | grep instructions
-fi
\ No newline at end of file
+fi
@@ -0,0 +1,235 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+
+#include "geometry/space.hpp"
+#include "server/game_state.hpp"
+#include "ui/rasterizer.hpp"
+#include "ui/ui.hpp"
+#include "utility/geometry_importer.hpp"
+
+// Kernel benchmarks over synthetic scenes. Scene sizes go from 1k triangles
+// up to the world limit; run from the repository root so that the textured
+// rasterizers find their texture.
+
+namespace {
+constexpr int64_t kMinSceneTriangles = 1 << 10;
+constexpr int64_t kMaxSceneTriangles =
+    std::min<int64_t>(1 << 20, kMaxTriangles);
+
+size_t GetGridSide(size_t triangle_count) noexcept {
+  return std::ceil(std::sqrt(triangle_count / 2.0));
+}
+
+// Square grid of triangle_count triangles facing the default camera, spanning
+// [-extent, extent] on both axes at the given depth
+Mesh CreateGridMesh(size_t triangle_count, float extent, float z) {
+  Mesh mesh;
+  size_t side = ::GetGridSide(triangle_count);
+  for (size_t row = 0; row <= side; row++)
+    for (size_t column = 0; column <= side; column++) {
+      float u = static_cast<float>(column) / side;
+      float v = static_cast<float>(row) / side;
+      mesh.EnqueueAddVertex(Vertex({extent * (2 * u - 1), extent * (2 * v - 1),
+                                    z, 1},
+                                   {u, v}));
+    }
+  size_t added = 0;
+  for (size_t row = 0; row < side; row++)
+    for (size_t column = 0; column < side; column++) {
+      uint32_t a = row * (side + 1) + column;
+      uint32_t b = a + 1;
+      uint32_t c = a + side + 1;
+      uint32_t d = c + 1;
+      if (added++ < triangle_count)
+        mesh.EnqueueAddTriangle(a, c, b);
+      if (added++ < triangle_count)
+        mesh.EnqueueAddTriangle(b, c, d);
+    }
+  mesh.UpdateMesh();
+  return mesh;
+}
+
+std::string CreateGridObj(size_t triangle_count) {
+  std::stringstream ss;
+  size_t side = ::GetGridSide(triangle_count);
+  for (size_t row = 0; row <= side; row++)
+    for (size_t column = 0; column <= side; column++) {
+      ss << "v " << column << " " << row << " 0\n";
+      ss << "vt " << static_cast<float>(column) / side << " "
+         << static_cast<float>(row) / side << "\n";
+    }
+  size_t added = 0;
+  for (size_t row = 0; row < side; row++)
+    for (size_t column = 0; column < side; column++) {
+      size_t a = row * (side + 1) + column + 1;
+      size_t b = a + 1;
+      size_t c = a + side + 1;
+      size_t d = c + 1;
+      if (added++ < triangle_count)
+        ss << "f " << a << "/" << a << " " << b << "/" << b << " " << c << "/"
+           << c << "\n";
+      if (added++ < triangle_count)
+        ss << "f " << b << "/" << b << " " << d << "/" << d << " " << c << "/"
+           << c << "\n";
+    }
+  return ss.str();
+}
+
+std::vector<uint32_t> GetAllTriangleIndices(const Mesh& mesh) {
+  std::vector<uint32_t> triangle_indices(mesh.GetTriangleCount());
+  for (size_t t = 0; t < triangle_indices.size(); t++)
+    triangle_indices[t] = t;
+  return triangle_indices;
+}
+
+void FillSpace(Space& space, size_t triangle_count) {
+  Mesh mesh = ::CreateGridMesh(triangle_count, 0.5, 0.5);
+  space.AssembleTriangles(mesh, mesh.GetVertices(),
+                          ::GetAllTriangleIndices(mesh));
+}
+
+void SceneSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->RangeMultiplier(8)->Range(kMinSceneTriangles, kMaxSceneTriangles);
+}
+
+// Removes every other triangle and adds back half as many
+void BM_SpaceUpdateSpace(benchmark::State& state) {
+  size_t triangle_count = state.range(0);
+  std::vector<Triangle> added;
+  for (size_t i = 0; i < triangle_count / 4; i++)
+    added.push_back({{0, 0, 0}, {1, 0, 0}, {0, 1, 0}});
+  for (auto _ : state) {
+    state.PauseTiming();
+    Space space;
+    ::FillSpace(space, triangle_count);
+    for (size_t i = 0; i < triangle_count; i += 2)
+      space.EnqueueRemoveTriangle(i);
+    space.EnqueueAddMultipleTriangles(added);
+    state.ResumeTiming();
+    space.UpdateSpace();
+  }
+  state.SetItemsProcessed(state.iterations() * triangle_count);
+}
+BENCHMARK(BM_SpaceUpdateSpace)->Apply(::SceneSizes);
+
+// Most triangles straddle the positive clipping plane of the given axis and
+// are split in up to two, hence the smaller scenes
+void BM_SpaceAssembleClippedTriangles(benchmark::State& state) {
+  size_t triangle_count = state.range(0);
+  Axis axis = static_cast<Axis>(state.range(1));
+  Mesh mesh = ::CreateGridMesh(triangle_count, 0.5, 0.5);
+  VertexMatrix clip_vertices = mesh.GetVertices();
+  for (int64_t c = 0; c < clip_vertices.cols(); c++)
+    clip_vertices(axis, c) += c % 2 ? 1.0 : 0.5;
+  std::vector<uint32_t> triangle_indices = ::GetAllTriangleIndices(mesh);
+  Space space;
+  for (auto _ : state) {
+    space.AssembleTriangles(mesh, clip_vertices, triangle_indices);
+    benchmark::DoNotOptimize(space.GetTriangleCount());
+  }
+  state.SetItemsProcessed(state.iterations() * triangle_count);
+}
+BENCHMARK(BM_SpaceAssembleClippedTriangles)
+    ->ArgsProduct({benchmark::CreateRange(kMinSceneTriangles,
+                                          kMaxSceneTriangles / 2, 8),
+                   {kX, kY, kZ}});
+
+// The fused vertex kernel of the pipeline over every vertex of the grid
+void BM_ProjectVertices(benchmark::State& state) {
+  Mesh mesh = ::CreateGridMesh(state.range(0), 1, 0);
+  CameraTransform camera;
+  PerspectiveProjection perspective(1, 10, -1, 1, 1, -1);
+  ViewportTransform viewport(kDefaultWindowWidth, kDefaultWindowHeight);
+  const Matrix4 clip_transform = perspective.GetMatrix() * camera.GetMatrix();
+  std::vector<Containment> chunk_containment(
+      (mesh.GetVertexCount() + kVertexChunkSize - 1) / kVertexChunkSize,
+      Containment::kIntersecting);
+  ProjectedVertices projected_vertices;
+  for (auto _ : state) {
+    ::ProjectVertices(mesh.GetVertices(), clip_transform, viewport.GetMatrix(),
+                      chunk_containment, JobSystem::GetInstance(),
+                      projected_vertices);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.GetVertexCount());
+}
+BENCHMARK(BM_ProjectVertices)->Apply(::SceneSizes);
+
+// Reference kernels: the separate passes over output triangles that
+// ProjectVertices replaced in the pipeline, kept for comparison
+void BM_ReferenceSpaceTransformVertices(benchmark::State& state) {
+  Space space;
+  ::FillSpace(space, state.range(0));
+  Matrix4 transformation = Matrix4::Identity();
+  for (auto _ : state) {
+    space.TransformVertices(transformation);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReferenceSpaceTransformVertices)->Apply(::SceneSizes);
+
+void BM_ReferenceSpaceDehomogenize(benchmark::State& state) {
+  Space space;
+  ::FillSpace(space, state.range(0));
+  for (auto _ : state) {
+    space.Dehomogenize();
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReferenceSpaceDehomogenize)->Apply(::SceneSizes);
+
+void BM_ObjGeometryImporter(benchmark::State& state) {
+  std::string obj = ::CreateGridObj(state.range(0));
+  for (auto _ : state) {
+    Mesh mesh;
+    auto importer = std::make_unique<ObjGeometryImporter>(mesh);
+    std::stringstream ss(obj);
+    importer->ImportGeometryFromInputStream(ss);
+    benchmark::DoNotOptimize(mesh.GetTriangleCount());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * obj.size());
+}
+BENCHMARK(BM_ObjGeometryImporter)->Apply(::SceneSizes);
+
+// The whole geometry stage, dominated by the vertex kernel for large meshes
+void BM_GameStateProcessTick(benchmark::State& state) {
+  GameState game_state(::CreateGridMesh(state.range(0), 1, 0));
+  for (auto _ : state)
+    game_state.ProcessTick();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GameStateProcessTick)->Apply(::SceneSizes);
+
+// The grid fills the middle of the screen from the default camera
+template <typename RasterizerType>
+void BM_RasterizeGameState(benchmark::State& state) {
+  GameState game_state(::CreateGridMesh(state.range(0), 1, 0));
+  game_state.ProcessTick();
+  auto user_interface = std::make_unique<BenchmarkInterface>();
+  auto rasterizer = std::make_unique<RasterizerType>();
+  for (auto _ : state)
+    rasterizer->RasterizeGameState(game_state, *user_interface);
+  state.SetItemsProcessed(state.iterations() *
+                          game_state.GetOutputSpace().GetTriangleCount());
+}
+BENCHMARK_TEMPLATE(BM_RasterizeGameState, WireframeRasterizer)
+    ->Apply(::SceneSizes);
+BENCHMARK_TEMPLATE(BM_RasterizeGameState, ScanlineRasterizer)
+    ->Apply(::SceneSizes);
+BENCHMARK_TEMPLATE(BM_RasterizeGameState, FlatRasterizer)->Apply(::SceneSizes);
+BENCHMARK_TEMPLATE(BM_RasterizeGameState, EdgeFunctionRasterizer)
+    ->Apply(::SceneSizes);
+BENCHMARK_TEMPLATE(BM_RasterizeGameState, TexturedRasterizer)
+    ->Apply(::SceneSizes);
+BENCHMARK_TEMPLATE(BM_RasterizeGameState, TiledRasterizer)
+    ->Apply(::SceneSizes);
+}  // namespace
+
+BENCHMARK_MAIN();
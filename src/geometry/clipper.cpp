@@ -0,0 +1,96 @@
+#include <iterator>
+
+#include "clipper.hpp"
+
+namespace {
+typedef struct ClipPlane {
+  Axis axis;
+  AxisDirection axis_direction;
+  float w_scale;
+} ClipPlane;
+
+// Indexed by outcode bit
+constexpr ClipPlane kClipPlanes[] = {
+    {kX, kNegative, 1},
+    {kX, kPositive, 1},
+    {kY, kNegative, 1},
+    {kY, kPositive, 1},
+    {kZ, kNegative, 1},
+    {kZ, kPositive, 1},
+    {kX, kNegative, kGuardBandScale},
+    {kX, kPositive, kGuardBandScale},
+    {kY, kNegative, kGuardBandScale},
+    {kY, kPositive, kGuardBandScale}};
+
+// Non-negative on the inner side of the plane
+float GetSignedDistance(const Vector4& vertex, const ClipPlane& plane) noexcept {
+  return plane.w_scale * vertex[kW] - plane.axis_direction * vertex[plane.axis];
+}
+}  // namespace
+
+Outcode HomogeneousClipper::GetOutcode(const Vector4& vertex) noexcept {
+  Outcode outcode = 0;
+  for (size_t plane = 0; plane < std::size(kClipPlanes); plane++)
+    if (::GetSignedDistance(vertex, kClipPlanes[plane]) < 0)
+      outcode |= 1 << plane;
+  return outcode;
+}
+
+ClipPolygon& HomogeneousClipper::GetInputPolygon() noexcept {
+  return polygons_[0];
+}
+
+// At most kNumberOfClippingPlanes planes may be flagged, which is the case
+// for either the view volume or the guard band with the depth planes
+const ClipPolygon& HomogeneousClipper::Clip(Outcode planes) noexcept {
+  size_t current = 0;
+  for (size_t plane = 0; plane < std::size(kClipPlanes); plane++) {
+    if (!(planes & 1 << plane))
+      continue;
+    ClipAgainstPlane(polygons_[current], polygons_[1 - current], plane);
+    current = 1 - current;
+    if (polygons_[current].vertex_count < kVerticesPerTriangle) {
+      polygons_[current].vertex_count = 0;
+      return polygons_[current];
+    }
+  }
+  return polygons_[current];
+}
+
+// Intersections are always interpolated from the inner towards the outer
+// vertex, so that an edge shared by two triangles is split at the same point
+void HomogeneousClipper::ClipAgainstPlane(
+    const ClipPolygon& input,
+    ClipPolygon& output,
+    size_t plane) noexcept {
+  const ClipPlane& clip_plane = kClipPlanes[plane];
+  output.vertex_count = 0;
+  size_t previous = input.vertex_count - 1;
+  float previous_distance =
+      ::GetSignedDistance(input.positions[previous], clip_plane);
+  for (size_t i = 0; i < input.vertex_count; i++) {
+    float distance = ::GetSignedDistance(input.positions[i], clip_plane);
+    if ((previous_distance >= 0) != (distance >= 0)) {
+      size_t inner = distance >= 0 ? i : previous;
+      size_t outer = distance >= 0 ? previous : i;
+      float inner_distance = distance >= 0 ? distance : previous_distance;
+      float outer_distance = distance >= 0 ? previous_distance : distance;
+      float t = inner_distance / (inner_distance - outer_distance);
+      output.positions[output.vertex_count] =
+          input.positions[inner] +
+          t * (input.positions[outer] - input.positions[inner]);
+      output.uv_coordinates[output.vertex_count] =
+          input.uv_coordinates[inner] +
+          t * (input.uv_coordinates[outer] - input.uv_coordinates[inner]);
+      output.vertex_count++;
+    }
+    if (distance >= 0) {
+      output.positions[output.vertex_count] = input.positions[i];
+      output.uv_coordinates[output.vertex_count] = input.uv_coordinates[i];
+      output.vertex_count++;
+    }
+    previous = i;
+    previous_distance = distance;
+  }
+  assert(output.vertex_count <= kMaxClippedVertices);
+}
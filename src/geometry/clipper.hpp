@@ -0,0 +1,39 @@
+#ifndef CLIPPER_HPP
+#define CLIPPER_HPP
+
+#include <array>
+#include "common.hpp"
+
+// One bit per clipping plane, set if the vertex lies outside of it. The low
+// six bits belong to the view volume and the next four to the X/Y planes of
+// the guard band, which lies kGuardBandScale times further out.
+typedef uint16_t Outcode;
+
+constexpr Outcode kViewVolumePlanes = 0x3f;
+constexpr Outcode kDepthPlanes = 0x30;
+constexpr Outcode kGuardBandPlanes = 0x3c0;
+
+typedef struct ClipPolygon {
+  std::array<Vector4, kMaxClippedVertices> positions;
+  std::array<Vector2, kMaxClippedVertices> uv_coordinates;
+  size_t vertex_count;
+} ClipPolygon;
+
+// Sutherland-Hodgman clipping in homogeneous coordinates against the view
+// volume -w <= x, y, z <= w or against the guard band. Only the planes
+// flagged in the outcode union of the input vertices are visited.
+class HomogeneousClipper {
+ public:
+  static Outcode GetOutcode(const Vector4& vertex) noexcept;
+  ClipPolygon& GetInputPolygon() noexcept;
+  const ClipPolygon& Clip(Outcode planes) noexcept;
+
+ private:
+  static void ClipAgainstPlane(const ClipPolygon& input,
+                               ClipPolygon& output,
+                               size_t plane) noexcept;
+
+  std::array<ClipPolygon, 2> polygons_;
+};
+
+#endif
@@ -15,18 +15,53 @@ constexpr float kFloatTolerance = 1.0E-3;
 constexpr float kAntiZFighting = 1.0E-5;
 constexpr float kFarPlaneDistance = 10.0;
 constexpr float kNearPlaneDistance = 1.0;
+constexpr float kClearDepth = 1;
+constexpr float kDepthBias = 0.001;
 constexpr size_t kBytesPerPixel = 4;
 constexpr size_t kDimensions = 4;
 constexpr size_t kSpatialDimensions = 3;
 constexpr size_t kUVDimensions = 2;
 constexpr size_t kVerticesPerTriangle = 3;
 constexpr size_t kViewportDimensions = 3;
-constexpr size_t kMaxTriangles = 10000;
+// Default caps of the importer; storage grows with the scene up to them
+constexpr size_t kMaxTriangles = 1 << 23;
 constexpr size_t kMaxVertices = kMaxTriangles;
 constexpr size_t kNumberOfClippingPlanes = 6;
+constexpr float kGuardBandScale = 4.0;
+// Smallest window-space area kept by the optional screen-space cull, in
+// square pixels, and the sign of the area of triangles facing the camera
+constexpr float kMinScreenTriangleArea = 0.5;
+constexpr float kFrontFacingAreaSign = 1;
+constexpr size_t kMaxClippedVertices =
+    kVerticesPerTriangle + kNumberOfClippingPlanes;
 constexpr size_t kNumberOfPixelChannels = 4;
-constexpr uint16_t kWindowWidth = 800;
-constexpr uint16_t kWindowHeight = 800;
+constexpr uint16_t kDefaultWindowWidth = 800;
+constexpr uint16_t kDefaultWindowHeight = 800;
+// Keeps guard-band pixel coordinates within int16_t
+constexpr uint16_t kMaxWindowSize = 8192;
+constexpr size_t kCacheLineSize = 64;
+// Mesh vertices per job of the vertex kernel; the columns it reads and writes
+// stay within the L1 cache
+constexpr size_t kVertexChunkSize = 512;
+// Listed triangles per job of triangle assembly
+constexpr size_t kAssemblyChunkSize = 1024;
+constexpr uint16_t kRasterizerTileSize = 64;
+// Output triangles per job of the triangle setup before tile binning
+constexpr size_t kTriangleSetupChunkSize = 1024;
+// Jobs each queue of the job system holds; a power of two. Submitters run
+// jobs themselves rather than wait for room.
+constexpr size_t kJobQueueCapacity = 1024;
+// Bytes of a submitted callable stored in the queued job itself
+constexpr size_t kJobStorageSize = 32;
+constexpr uint16_t kPerspectiveSpanLength = 16;
+constexpr uint16_t kCoarseDepthTileSize = 8;
+constexpr uint16_t kHeatmapLevels = 8;
+// Dynamic resolution scales the window size in steps of 1 / kRenderScaleSteps
+constexpr uint16_t kRenderScaleSteps = 16;
+constexpr uint16_t kMinRenderScaleSteps = 4;
+constexpr size_t kRenderScaleSettleFrames = 8;
+constexpr float kFrameTimeSmoothing = 0.2;
+constexpr float kRenderScaleHeadroom = 0.9;
 constexpr bool kClockwiseWinding = true;
 constexpr bool kCounterClockwiseWinding = !kClockwiseWinding;
 constexpr float kTranslationIncrement = 0.01;
@@ -34,28 +69,59 @@ constexpr float kAngularIncrement = 0.01;
 constexpr float kViewportRoundingBias = 0.1;
 constexpr SDL_PixelFormatEnum kDefaultPixelFormat = SDL_PIXELFORMAT_ARGB8888;
 
+class Mesh;
 class Point;
 class Space;
 class Triangle;
 
 typedef std::array<Point, 2> TrianglePlaneIntersections;
 typedef std::shared_ptr<Space> SpaceSharedPointer;
-typedef std::shared_ptr<Triangle> TriangleSharedPointer;
 typedef Eigen::Vector2f Vector2;
 typedef Eigen::Vector3f Vector3;
 typedef Eigen::Vector4f Vector4;
 typedef Eigen::Matrix4f Matrix4;
 typedef Eigen::Quaternionf Quaternion;
-typedef Eigen::Array<int, kVerticesPerTriangle, Eigen::Dynamic> ClippingMask;
 typedef Eigen::Matrix<float, kDimensions, Eigen::Dynamic> NormalMatrix;
+typedef Eigen::Matrix<float, kUVDimensions, Eigen::Dynamic> UVMatrix;
+typedef Eigen::Matrix<uint32_t, kVerticesPerTriangle, Eigen::Dynamic>
+    TriangleIndexMatrix;
 typedef Eigen::Matrix<float, kDimensions, Eigen::Dynamic> VertexMatrix;
+// One row per triangle, so that each coefficient is contiguous across them
+typedef Eigen::Matrix<float, Eigen::Dynamic, kDimensions> FacePlaneMatrix;
+typedef Eigen::Map<const NormalMatrix> NormalMatrixView;
+typedef Eigen::Map<const UVMatrix> UVMatrixView;
+typedef Eigen::Map<const VertexMatrix> VertexMatrixView;
 
 enum class BoundaryType { kMin, kMax };
-enum class TriangleClipMode { kIncludeReference, kExcludeReference };
+enum class ClipMode { kViewVolume, kGuardBand };
+// Ordered so that the larger of two values describes both
+enum class Containment { kOutside, kInside, kIntersecting };
+enum class HeatmapMetric { kFragmentWrites, kDepthTests };
 enum class TriangleHalf { kUpper, kLower };
 enum TriangleEdge { kAB = 0, kAC = 1, kBC = 2 };
 enum Axis { kX = 0, kY = 1, kZ = 2, kW = 3 };
 enum UVDimension { kU = 0, kV = 1 };
 enum AxisDirection { kNegative = -1, kNeutral = 0, kPositive = 1 };
 
+// Per-frame geometry counters, in the spirit of GPU pipeline statistics
+// queries. Clipped triangles are replaced by the ones produced by clipping.
+typedef struct PipelineStatistics {
+  size_t input_triangles;
+  size_t frustum_culled;
+  size_t back_face_culled;
+  size_t screen_culled;
+  size_t trivially_rejected;
+  size_t clipped;
+  size_t produced_by_clipping;
+} PipelineStatistics;
+
+// Per-frame fragment counters. Covered pixels were written at least once, so
+// the overdraw ratio is the number of depth passes per covered pixel.
+typedef struct RasterizerStatistics {
+  uint64_t depth_tested;
+  uint64_t depth_passed;
+  uint64_t pixels_covered;
+  float overdraw_ratio;
+} RasterizerStatistics;
+
 #endif
\ No newline at end of file
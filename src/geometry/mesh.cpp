@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mesh.hpp"
+
+Mesh::Mesh() : object_first_triangles_{0} {}
+
+// Returns the index the vertex will have once the mesh is updated
+uint32_t Mesh::EnqueueAddVertex(const Vertex& vertex) {
+  vertex_add_queue_.push_back(vertex);
+  return vertices_.cols() + vertex_add_queue_.size() - 1;
+}
+
+void Mesh::EnqueueAddTriangle(uint32_t a_index,
+                              uint32_t b_index,
+                              uint32_t c_index) {
+  Vector4 a = GetPosition(a_index);
+  triangle_add_queue_.push_back({a_index, b_index, c_index});
+  normal_add_queue_.push_back(
+      (GetPosition(b_index) - a).cross3(GetPosition(c_index) - a));
+}
+
+// Adds a triangle whose vertices are not shared with any other triangle
+void Mesh::EnqueueAddTriangle(const Triangle& triangle) {
+  std::array<uint32_t, kVerticesPerTriangle> triangle_indices;
+  for (size_t k = 0; k < kVerticesPerTriangle; k++)
+    triangle_indices[k] = EnqueueAddVertex(triangle.GetVertex(k));
+  triangle_add_queue_.push_back(triangle_indices);
+  normal_add_queue_.push_back(triangle.GetNormal());
+}
+
+// Triangles enqueued from now on belong to a new object
+void Mesh::BeginObject() {
+  size_t first_triangle = indices_.cols() + triangle_add_queue_.size();
+  if (object_first_triangles_.back() != first_triangle)
+    object_first_triangles_.push_back(first_triangle);
+}
+
+void Mesh::UpdateMesh() {
+  size_t vertex_count = vertices_.cols();
+  size_t triangle_count = indices_.cols();
+  vertices_.conservativeResize(kDimensions,
+                               vertex_count + vertex_add_queue_.size());
+  uv_coordinates_.conservativeResize(kUVDimensions, vertices_.cols());
+  for (const Vertex& vertex : vertex_add_queue_) {
+    vertices_.col(vertex_count) = vertex.GetVector();
+    uv_coordinates_.col(vertex_count) = vertex.GetUVCoordinate().GetVector();
+    vertex_count++;
+  }
+  indices_.conservativeResize(kVerticesPerTriangle,
+                              triangle_count + triangle_add_queue_.size());
+  normals_.conservativeResize(kDimensions, indices_.cols());
+  face_planes_.conservativeResize(indices_.cols(), kDimensions);
+  for (size_t i = 0; i < triangle_add_queue_.size(); i++) {
+    for (size_t k = 0; k < kVerticesPerTriangle; k++) {
+      assert(triangle_add_queue_[i][k] < vertex_count);
+      indices_(k, triangle_count + i) = triangle_add_queue_[i][k];
+    }
+    const Vector4& normal = normal_add_queue_[i];
+    normals_.col(triangle_count + i) = normal;
+    Vector3 first_vertex = vertices_.col(triangle_add_queue_[i][0]).head<3>();
+    face_planes_.row(triangle_count + i)
+        << normal.head<3>().transpose(),
+        -normal.head<3>().dot(first_vertex);
+  }
+  vertex_add_queue_.clear();
+  triangle_add_queue_.clear();
+  normal_add_queue_.clear();
+  UpdateObjects();
+}
+
+size_t Mesh::GetVertexCount() const {
+  return vertices_.cols();
+}
+
+size_t Mesh::GetTriangleCount() const {
+  return indices_.cols();
+}
+
+const VertexMatrix& Mesh::GetVertices() const {
+  return vertices_;
+}
+
+const UVMatrix& Mesh::GetUVCoordinates() const {
+  return uv_coordinates_;
+}
+
+const TriangleIndexMatrix& Mesh::GetIndices() const {
+  return indices_;
+}
+
+const NormalMatrix& Mesh::GetNormals() const {
+  return normals_;
+}
+
+// Plane of each triangle as (normal, -normal . first vertex); evaluated at a
+// point, it gives the distance along the normal scaled by the normal length
+const FacePlaneMatrix& Mesh::GetFacePlanes() const {
+  return face_planes_;
+}
+
+const std::vector<MeshObject>& Mesh::GetObjects() const {
+  return objects_;
+}
+
+// The sphere is centered on the bounding box of the referenced vertices,
+// which is tighter than their centroid for unevenly tessellated objects
+void Mesh::UpdateObjects() {
+  objects_.clear();
+  for (size_t o = 0; o < object_first_triangles_.size(); o++) {
+    size_t first_triangle = object_first_triangles_[o];
+    size_t end_triangle = o + 1 < object_first_triangles_.size()
+                              ? object_first_triangles_[o + 1]
+                              : indices_.cols();
+    if (first_triangle == end_triangle)
+      continue;
+    auto object_indices =
+        indices_.middleCols(first_triangle, end_triangle - first_triangle);
+    uint32_t first_vertex = object_indices.minCoeff();
+    uint32_t end_vertex = object_indices.maxCoeff() + 1;
+    Vector3 box_min = Vector3::Constant(std::numeric_limits<float>::max());
+    Vector3 box_max = -box_min;
+    for (size_t i = 0; i < static_cast<size_t>(object_indices.size()); i++) {
+      Vector3 position = GetPosition(object_indices(i)).hnormalized();
+      box_min = box_min.cwiseMin(position);
+      box_max = box_max.cwiseMax(position);
+    }
+    Vector3 center = (box_min + box_max) / 2;
+    float squared_radius = 0;
+    for (size_t i = 0; i < static_cast<size_t>(object_indices.size()); i++)
+      squared_radius = std::max(
+          squared_radius,
+          (GetPosition(object_indices(i)).hnormalized() - center).squaredNorm());
+    objects_.push_back({static_cast<uint32_t>(first_triangle),
+                        static_cast<uint32_t>(end_triangle - first_triangle),
+                        first_vertex, end_vertex - first_vertex, center,
+                        std::sqrt(squared_radius)});
+  }
+}
+
+Vector4 Mesh::GetPosition(uint32_t vertex_index) const {
+  size_t stored_count = vertices_.cols();
+  if (vertex_index < stored_count)
+    return vertices_.col(vertex_index);
+  assert(vertex_index - stored_count < vertex_add_queue_.size());
+  return vertex_add_queue_[vertex_index - stored_count].GetVector();
+}
@@ -0,0 +1,55 @@
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include <vector>
+#include "triangle.hpp"
+
+// Consecutive triangles of a mesh that are culled together, with the span of
+// vertex indices they reference and a sphere that bounds those vertices
+typedef struct MeshObject {
+  uint32_t first_triangle;
+  uint32_t triangle_count;
+  uint32_t first_vertex;
+  uint32_t vertex_count;
+  Vector3 bounding_center;
+  float bounding_radius;
+} MeshObject;
+
+// Indexed triangle mesh. Each unique (position, UV) pair is stored once and
+// referenced by every triangle that uses it; normals are stored per triangle.
+// The triangles are split into objects, a single one unless BeginObject is
+// called in between them.
+class Mesh {
+ public:
+  Mesh();
+  uint32_t EnqueueAddVertex(const Vertex& vertex);
+  void EnqueueAddTriangle(uint32_t a_index, uint32_t b_index, uint32_t c_index);
+  void EnqueueAddTriangle(const Triangle& triangle);
+  void BeginObject();
+  void UpdateMesh();
+  size_t GetVertexCount() const;
+  size_t GetTriangleCount() const;
+  const VertexMatrix& GetVertices() const;
+  const UVMatrix& GetUVCoordinates() const;
+  const TriangleIndexMatrix& GetIndices() const;
+  const NormalMatrix& GetNormals() const;
+  const FacePlaneMatrix& GetFacePlanes() const;
+  const std::vector<MeshObject>& GetObjects() const;
+
+ private:
+  Vector4 GetPosition(uint32_t vertex_index) const;
+  void UpdateObjects();
+
+  std::vector<Vertex> vertex_add_queue_;
+  std::vector<std::array<uint32_t, kVerticesPerTriangle>> triangle_add_queue_;
+  std::vector<Vector4> normal_add_queue_;
+  VertexMatrix vertices_;
+  UVMatrix uv_coordinates_;
+  TriangleIndexMatrix indices_;
+  NormalMatrix normals_;
+  FacePlaneMatrix face_planes_;
+  std::vector<size_t> object_first_triangles_;
+  std::vector<MeshObject> objects_;
+};
+
+#endif
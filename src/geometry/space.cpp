@@ -1,124 +1,82 @@
+#include <algorithm>
 #include <array>
 #include <memory>
 
-#include "line_segment.hpp"
 #include "space.hpp"
+#include "utility/profiler.hpp"
 
 namespace {
 void CopyTriangleColumnsInMatrix(size_t source_index,
                                  size_t destination_index,
                                  VertexMatrix& vertices,
+                                 UVMatrix& uv_coordinates,
                                  NormalMatrix& normals) {
-  assert(source_index < kMaxTriangles);
-  assert(destination_index < kMaxTriangles);
+  assert(source_index < static_cast<size_t>(normals.cols()));
+  assert(destination_index < static_cast<size_t>(normals.cols()));
   assert(source_index != destination_index);
-  size_t src = source_index * 3;
-  size_t dst = destination_index * 3;
-  std::vector<size_t> src_cols = {src, src + 1, src + 2};
-  std::vector<size_t> dst_cols = {dst, dst + 1, dst + 2};
-  vertices(Eigen::all, dst_cols) = vertices(Eigen::all, src_cols);
+  size_t src = source_index * kVerticesPerTriangle;
+  size_t dst = destination_index * kVerticesPerTriangle;
+  vertices.middleCols<kVerticesPerTriangle>(dst) =
+      vertices.middleCols<kVerticesPerTriangle>(src);
+  uv_coordinates.middleCols<kVerticesPerTriangle>(dst) =
+      uv_coordinates.middleCols<kVerticesPerTriangle>(src);
   normals.col(destination_index) = normals.col(source_index);
 }
 
 void UpdateMatrixColumnsFromTriangle(size_t destination_index,
-                                     TriangleSharedPointer triangle,
+                                     const Triangle& triangle,
                                      VertexMatrix& vertices,
+                                     UVMatrix& uv_coordinates,
                                      NormalMatrix& normals) {
-  size_t i = destination_index * 3;
-  for (size_t k : {0, 1, 2})
-    vertices.col(i + k) = triangle->GetVertex(k).GetVector();
-  normals.col(destination_index) = triangle->GetNormal();
-}
-
-size_t FindVertexIndexByClipMask(Eigen::Array<int, 3, 1> mask_column,
-                                 int match_mask_value) {
-  for (size_t index : {0, 1, 2})
-    if (mask_column(index) == match_mask_value)
-      return index;
-  return -1;
-}
-
-// #TODO: refactor
-void AddSubstituteTriangles(const VertexMatrix& vertices,
-                            const NormalMatrix& normals,
-                            const Triangle& triangle,
-                            size_t triangle_index,
-                            size_t ref_vertex_index,
-                            TriangleClipMode clip_mode,
-                            const InterpolatedVertex& iv_ab,
-                            const InterpolatedVertex& iv_ac,
-                            std::vector<TriangleSharedPointer>& substitutes) {
-  size_t column;
-  (void)normals;  // #TODO: finish normal implementation!!
-  Direction normal(triangle.GetNormal());
-  Vertex vertex_ab(iv_ab);
-  Vertex vertex_ac(iv_ac);
-  if (clip_mode == TriangleClipMode::kIncludeReference) {
-    column = triangle_index * kVerticesPerTriangle + ref_vertex_index;
-    Vertex vertex_1 =
-        Vertex(Vector4(vertices.col(column)),
-               triangle.GetVertex(ref_vertex_index).GetUVCoordinate());
-    substitutes.push_back(
-        std::make_shared<Triangle>(vertex_1, vertex_ab, vertex_ac, normal));
-  } else if (clip_mode == TriangleClipMode::kExcludeReference) {
-    column = triangle_index * kVerticesPerTriangle +
-             ((ref_vertex_index + 1) % kVerticesPerTriangle);
-    Vertex vertex_2 = Vertex(
-        Vector4(vertices.col(column)),
-        triangle.GetVertex(column % kVerticesPerTriangle).GetUVCoordinate());
-    column = triangle_index * kVerticesPerTriangle +
-             ((ref_vertex_index + 2) % kVerticesPerTriangle);
-    Vertex vertex_3 = Vertex(
-        Vector4(vertices.col(column)),
-        triangle.GetVertex(column % kVerticesPerTriangle).GetUVCoordinate());
-    substitutes.push_back(
-        std::make_shared<Triangle>(vertex_ab, vertex_2, vertex_ac, normal));
-    substitutes.push_back(
-        std::make_shared<Triangle>(vertex_ac, vertex_2, vertex_3, normal));
+  size_t i = destination_index * kVerticesPerTriangle;
+  for (size_t k : {0, 1, 2}) {
+    const Vertex& vertex = triangle.GetVertex(k);
+    vertices.col(i + k) = vertex.GetVector();
+    uv_coordinates.col(i + k) = vertex.GetUVCoordinate().GetVector();
   }
+  normals.col(destination_index) = triangle.GetNormal();
 }
 
-float HomogeneousInterpolation(Vector4 vector_a,
-                               Vector4 vector_b,
-                               Axis axis,
-                               AxisDirection axis_direction) {
-  float a_val = vector_a[axis];
-  float b_val = vector_b[axis];
-  float a_w = axis_direction * vector_a[kW];
-  float b_w = axis_direction * vector_b[kW];
-  assert(a_val - a_w - b_val + b_w != 0);  // #TODO: investigate
-  return (a_val - a_w) / (a_val - a_w - b_val + b_w);
-}
-
-bool SortClipVertices(const Vector4& lhs, const Vector4& rhs) noexcept {
-  if (lhs(kX) == rhs(kX)) {
-    if (lhs(kY) == rhs(kY)) {
-      if (lhs(kZ) == rhs(kZ)) {
-        return lhs(kW) < rhs(kW);
-      }
-      return lhs(kZ) < rhs(kZ);
-    }
-    return lhs(kY) < rhs(kY);
+void CombineTriangleOutcodes(const std::vector<Outcode>& vertex_outcodes,
+                             const TriangleIndexMatrix& indices,
+                             uint32_t triangle_index,
+                             Outcode& outcode_and,
+                             Outcode& outcode_or) {
+  outcode_and = outcode_or = vertex_outcodes[indices(0, triangle_index)];
+  for (size_t k = 1; k < kVerticesPerTriangle; k++) {
+    outcode_and &= vertex_outcodes[indices(k, triangle_index)];
+    outcode_or |= vertex_outcodes[indices(k, triangle_index)];
   }
-  return lhs(kX) < rhs(kX);
 }
 }  // namespace
 
-Space::Space() : triangles_{0} {}
+Space::Space()
+    : assembly_statistics_{},
+      job_system_(&JobSystem::GetInstance()) {}
 
-void Space::EnqueueAddTriangle(TriangleSharedPointer triangle_ptr) {
-  triangle_add_queue_.push(triangle_ptr);
+// Triangle assembly is split into jobs on the given system
+void Space::SetJobSystem(JobSystem& job_system) noexcept {
+  job_system_ = &job_system;
+}
+
+void Space::EnqueueAddTriangle(const Triangle& triangle) {
+  triangle_add_queue_.push(triangle);
 }
 
 void Space::EnqueueAddMultipleTriangles(
-    std::vector<TriangleSharedPointer> triangles) {
-  for (TriangleSharedPointer tr : triangles)
+    const std::vector<Triangle>& triangles) {
+  for (const Triangle& tr : triangles)
     triangle_add_queue_.push(tr);
 }
 
 void Space::EnqueueRemoveTriangle(size_t index) {
-  assert(index < kMaxTriangles);
-  triangle_remove_queue_.push(index);
+  assert(index < triangle_count_);
+  triangle_remove_queue_.push_back(index);
+}
+
+void Space::EnqueueRemoveMultipleTriangles(const std::vector<size_t>& indices) {
+  for (size_t index : indices)
+    EnqueueRemoveTriangle(index);
 }
 
 void Space::UpdateSpace() {
@@ -131,52 +89,243 @@ void Space::UpdateSpace() {
   triangle_count_ = update_parameters.final_triangle_count;
 }
 
+// Replaces the content with the listed mesh triangles. The mesh vertices are
+// given in homogeneous clip coordinates, one column per unique vertex of the
+// mesh. Triangles outside the view volume are dropped and those crossing its
+// boundary are clipped, so the result may hold more triangles than listed.
+// In guard-band mode only the depth planes and the guard band clip, and the
+// rasterizers scissor whatever extends beyond the viewport.
+void Space::AssembleTriangles(const Mesh& mesh,
+                              const VertexMatrix& mesh_vertices,
+                              const std::vector<uint32_t>& triangle_indices,
+                              ClipMode clip_mode) {
+  PROFILE_ZONE("AssembleTriangles");
+  assert(mesh_vertices.cols() == mesh.GetVertices().cols());
+  vertex_outcodes_.resize(mesh_vertices.cols());
+  for (size_t v = 0; v < vertex_outcodes_.size(); v++)
+    vertex_outcodes_[v] = HomogeneousClipper::GetOutcode(mesh_vertices.col(v));
+  EmitTriangles(mesh, mesh_vertices, vertex_outcodes_, nullptr,
+                Matrix4::Identity(), triangle_indices, nullptr, clip_mode);
+}
+
+// Like AssembleTriangles, but takes the outcodes and window positions from
+// the vertex kernel and produces window coordinates. Only the vertices of
+// clipped triangles are divided and mapped to the viewport here. The listed
+// triangles flagged as inside the view volume are accepted without a look at
+// their outcodes.
+void Space::AssembleProjectedTriangles(
+    const Mesh& mesh,
+    const ProjectedVertices& mesh_vertices,
+    const Matrix4& viewport_matrix,
+    const std::vector<uint32_t>& triangle_indices,
+    const std::vector<bool>& triangle_inside,
+    ClipMode clip_mode) {
+  PROFILE_ZONE("AssembleTriangles");
+  assert(mesh_vertices.clip_positions.cols() == mesh.GetVertices().cols());
+  assert(triangle_inside.size() == triangle_indices.size());
+  EmitTriangles(mesh, mesh_vertices.clip_positions, mesh_vertices.outcodes,
+                &mesh_vertices.window_positions, viewport_matrix,
+                triangle_indices, &triangle_inside, clip_mode);
+}
+
+// Without window vertices, the output stays in clip coordinates. Chunks of
+// listed triangles are clipped in parallel into their own buffers; then the
+// output offset of every chunk follows from the triangle counts of the ones
+// before it, and the chunks write their triangles in parallel. The output is
+// the same as if the triangles were processed one after the other.
+void Space::EmitTriangles(const Mesh& mesh,
+                          const VertexMatrix& clip_vertices,
+                          const std::vector<Outcode>& outcodes,
+                          const VertexMatrix* window_vertices,
+                          const Matrix4& viewport_matrix,
+                          const std::vector<uint32_t>& triangle_indices,
+                          const std::vector<bool>* triangle_inside,
+                          ClipMode clip_mode) {
+  assert(triangle_add_queue_.empty() && triangle_remove_queue_.empty());
+  const TriangleIndexMatrix& indices = mesh.GetIndices();
+  const UVMatrix& mesh_uv_coordinates = mesh.GetUVCoordinates();
+  const VertexMatrix& accepted_vertices =
+      window_vertices ? *window_vertices : clip_vertices;
+  const Outcode clip_planes = clip_mode == ClipMode::kGuardBand
+                                  ? kDepthPlanes | kGuardBandPlanes
+                                  : kViewVolumePlanes;
+  auto combine_outcodes = [&](size_t i, Outcode& outcode_and,
+                              Outcode& outcode_or) {
+    if (triangle_inside && (*triangle_inside)[i])
+      outcode_and = outcode_or = 0;
+    else
+      ::CombineTriangleOutcodes(outcodes, indices, triangle_indices[i],
+                                outcode_and, outcode_or);
+  };
+  const size_t chunk_count =
+      (triangle_indices.size() + kAssemblyChunkSize - 1) / kAssemblyChunkSize;
+  if (assembly_chunks_.size() < chunk_count)
+    assembly_chunks_.resize(chunk_count);
+
+  {
+    PROFILE_ZONE("ClipChunks");
+    job_system_->ParallelFor(chunk_count, [&](size_t chunk_index) {
+      AssemblyChunk& chunk = assembly_chunks_[chunk_index];
+      size_t begin = chunk_index * kAssemblyChunkSize;
+      size_t end =
+          std::min(triangle_indices.size(), begin + kAssemblyChunkSize);
+      chunk.statistics = {};
+      chunk.fan_sizes.clear();
+      size_t accepted = 0;
+      Outcode outcode_and, outcode_or;
+      for (size_t i = begin; i < end; i++) {
+        combine_outcodes(i, outcode_and, outcode_or);
+        if (outcode_and & kViewVolumePlanes)
+          chunk.statistics.trivially_rejected++;
+        else if (outcode_or & clip_planes)
+          chunk.statistics.clipped++;
+        else
+          accepted++;
+      }
+      size_t capacity = chunk.statistics.clipped * (kMaxClippedVertices - 2) *
+                        kVerticesPerTriangle;
+      if (static_cast<size_t>(chunk.clipped_vertices.cols()) < capacity) {
+        chunk.clipped_vertices.resize(kDimensions, capacity);
+        chunk.clipped_uv_coordinates.resize(kUVDimensions, capacity);
+      }
+      size_t column = 0;
+      for (size_t i = begin; i < end; i++) {
+        uint32_t t = triangle_indices[i];
+        combine_outcodes(i, outcode_and, outcode_or);
+        if ((outcode_and & kViewVolumePlanes) || !(outcode_or & clip_planes))
+          continue;
+        ClipPolygon& input = chunk.clipper.GetInputPolygon();
+        input.vertex_count = kVerticesPerTriangle;
+        for (size_t k = 0; k < kVerticesPerTriangle; k++) {
+          input.positions[k] = clip_vertices.col(indices(k, t));
+          input.uv_coordinates[k] = mesh_uv_coordinates.col(indices(k, t));
+        }
+        const ClipPolygon& polygon =
+            chunk.clipper.Clip(outcode_or & clip_planes);
+        size_t fan_size = polygon.vertex_count >= kVerticesPerTriangle
+                              ? polygon.vertex_count - 2
+                              : 0;
+        chunk.statistics.produced_by_clipping += fan_size;
+        chunk.fan_sizes.push_back(fan_size);
+        // Triangle fan around the first vertex keeps the winding
+        for (size_t f = 1; f <= fan_size; f++)
+          for (size_t k : {size_t(0), f, f + 1}) {
+            const Vector4& position = polygon.positions[k];
+            if (window_vertices)
+              chunk.clipped_vertices.col(column) =
+                  viewport_matrix * (position / position[kW]);
+            else
+              chunk.clipped_vertices.col(column) = position;
+            chunk.clipped_uv_coordinates.col(column++) =
+                polygon.uv_coordinates[k];
+          }
+      }
+      chunk.triangle_count = accepted + column / kVerticesPerTriangle;
+    });
+  }
+
+  assembly_statistics_ = {};
+  assembly_statistics_.input_triangles = triangle_indices.size();
+  size_t count = 0;
+  for (size_t c = 0; c < chunk_count; c++) {
+    AssemblyChunk& chunk = assembly_chunks_[c];
+    chunk.first_triangle = count;
+    count += chunk.triangle_count;
+    assembly_statistics_.trivially_rejected +=
+        chunk.statistics.trivially_rejected;
+    assembly_statistics_.clipped += chunk.statistics.clipped;
+    assembly_statistics_.produced_by_clipping +=
+        chunk.statistics.produced_by_clipping;
+  }
+  ReserveTriangles(count, false);
+
+  PROFILE_ZONE("EmitChunks");
+  job_system_->ParallelFor(chunk_count, [&](size_t chunk_index) {
+    const AssemblyChunk& chunk = assembly_chunks_[chunk_index];
+    size_t begin = chunk_index * kAssemblyChunkSize;
+    size_t end = std::min(triangle_indices.size(), begin + kAssemblyChunkSize);
+    size_t triangle = chunk.first_triangle;
+    size_t clipped_column = 0;
+    auto fan_size = chunk.fan_sizes.begin();
+    Outcode outcode_and, outcode_or;
+    for (size_t i = begin; i < end; i++) {
+      uint32_t t = triangle_indices[i];
+      combine_outcodes(i, outcode_and, outcode_or);
+      if (outcode_and & kViewVolumePlanes)
+        continue;
+      if (!(outcode_or & clip_planes)) {
+        for (size_t k = 0; k < kVerticesPerTriangle; k++) {
+          uint32_t vertex_index = indices(k, t);
+          vertices_.col(triangle * kVerticesPerTriangle + k) =
+              accepted_vertices.col(vertex_index);
+          uv_coordinates_.col(triangle * kVerticesPerTriangle + k) =
+              mesh_uv_coordinates.col(vertex_index);
+        }
+        normals_.col(triangle++) = mesh.GetNormals().col(t);
+        continue;
+      }
+      for (size_t f = 0; f < *fan_size; f++) {
+        size_t n = kVerticesPerTriangle;
+        vertices_.middleCols(triangle * n, n) =
+            chunk.clipped_vertices.middleCols(clipped_column, n);
+        uv_coordinates_.middleCols(triangle * n, n) =
+            chunk.clipped_uv_coordinates.middleCols(clipped_column, n);
+        clipped_column += n;
+        normals_.col(triangle++) = mesh.GetNormals().col(t);
+      }
+      ++fan_size;
+    }
+  });
+  std::fill(triangle_slot_used_.begin(), triangle_slot_used_.begin() + count,
+            true);
+  triangle_count_ = count;
+}
+
 size_t Space::GetTriangleCount() const {
   return triangle_count_;
 }
 
-const std::array<TriangleSharedPointer, kMaxTriangles>& Space::GetTriangles()
-    const {
-  return triangles_;
+// Counters of the last assembly; every listed triangle counts as input
+const PipelineStatistics& Space::GetAssemblyStatistics() const noexcept {
+  return assembly_statistics_;
 }
 
-const VertexMatrix& Space::GetVertices() const {
-  return vertices_;
+// Assembles a Triangle from the streams; not meant for hot loops
+Triangle Space::GetTriangle(size_t index) const {
+  assert(index < triangle_count_);
+  std::array<Vertex, kVerticesPerTriangle> vertices;
+  for (size_t k = 0; k < kVerticesPerTriangle; k++) {
+    size_t column = index * kVerticesPerTriangle + k;
+    vertices[k] = Vertex(Vector4(vertices_.col(column)),
+                         UVCoordinate(Vector2(uv_coordinates_.col(column))));
+  }
+  return Triangle(vertices[0], vertices[1], vertices[2],
+                  Direction(Vector4(normals_.col(index))));
 }
 
-const NormalMatrix& Space::GetNormals() const {
-  return normals_;
+VertexMatrixView Space::GetVertices() const {
+  return VertexMatrixView(vertices_.data(), kDimensions,
+                          triangle_count_ * kVerticesPerTriangle);
 }
 
-std::vector<TriangleSharedPointer> Space::GetHomogeneousClipSubstitutes(
-    size_t triangle_index,
-    size_t single_vertex_index,
-    Axis axis,
-    AxisDirection axis_direction,
-    TriangleClipMode clip_mode) const {
-  InterpolatedVertex iv_ab, iv_ac;
-  GetInterpolatedVertices(triangle_index, single_vertex_index, axis,
-                          axis_direction, iv_ab, iv_ac);
-  std::vector<TriangleSharedPointer> substitutes;
-  // #TODO: vertex attributes
-  ::AddSubstituteTriangles(vertices_, normals_, *triangles_[triangle_index],
-                           triangle_index, single_vertex_index, clip_mode,
-                           iv_ab, iv_ac, substitutes);
-  return substitutes;
+UVMatrixView Space::GetUVCoordinates() const {
+  return UVMatrixView(uv_coordinates_.data(), kUVDimensions,
+                      triangle_count_ * kVerticesPerTriangle);
 }
 
-void Space::ClipAllTriangles(Axis axis, AxisDirection axis_direction) {
-  ClippingMask clipping_mask = HomogeneousClippingMask(axis, axis_direction);
-  ProcessHomogeneousClippingMask(clipping_mask, axis, axis_direction);
-  UpdateSpace();
+NormalMatrixView Space::GetNormals() const {
+  return NormalMatrixView(normals_.data(), kDimensions, triangle_count_);
 }
 
+// Column by column, so that the product needs no temporary matrix
 void Space::TransformVertices(const Matrix4& transformation) {
-  vertices_ = transformation * vertices_;
+  for (size_t c = 0; c < triangle_count_ * kVerticesPerTriangle; c++)
+    vertices_.col(c) = transformation * vertices_.col(c);
 }
 
 void Space::TransformNormals(const Matrix4& transformation) {
-  normals_ = transformation * normals_;
+  for (size_t c = 0; c < triangle_count_; c++)
+    normals_.col(c) = transformation * normals_.col(c);
 }
 
 void Space::InitializeUpdateSpaceParameters(
@@ -189,143 +338,88 @@ void Space::InitializeUpdateSpaceParameters(
                                     parameters.remove_queue_size;
   assert(parameters.initial_triangle_count + parameters.add_queue_size >=
          parameters.remove_queue_size);
-  assert(parameters.final_triangle_count <= kMaxTriangles);
 }
 
+// Added triangles take the removed slots in the order of removal; the slots
+// left over are only marked free
 void Space::ReplaceRemovedWithAdded(struct UpdateSpaceParameters& parameters) {
-  while (!triangle_remove_queue_.empty()) {
-    size_t i = triangle_remove_queue_.front();
-    triangle_remove_queue_.pop();
-    assert(triangles_[i]);
+  for (size_t i : triangle_remove_queue_) {
+    assert(i < parameters.initial_triangle_count);
+    assert(triangle_slot_used_[i]);
     if (!triangle_add_queue_.empty()) {
-      triangles_[i] = triangle_add_queue_.front();
+      ::UpdateMatrixColumnsFromTriangle(i, triangle_add_queue_.front(),
+                                        vertices_, uv_coordinates_, normals_);
       triangle_add_queue_.pop();
-      ::UpdateMatrixColumnsFromTriangle(i, triangles_[i], vertices_, normals_);
     } else {
       (void)parameters;  // required for Release build
       assert(parameters.final_triangle_count <
              parameters.initial_triangle_count);
       assert(parameters.remove_queue_size > parameters.add_queue_size);
-      triangles_[i] = nullptr;
+      triangle_slot_used_[i] = false;
     }
   }
+  triangle_remove_queue_.clear();
 }
 
+// Single pass from both ends of the used slots: free slots are filled front
+// to back with the last used triangles, so no triangle moves more than once
+// and only the removed ones below the final count are overwritten
 void Space::DefragmentVectorAndMatrices(
     struct UpdateSpaceParameters& parameters) {
   if (parameters.final_triangle_count >= parameters.initial_triangle_count)
     return;
-  auto begin = triangles_.begin();
-  auto rbegin = triangles_.rbegin();
-  auto end = triangles_.end();
-  auto rend = triangles_.rend();
-  auto is_not_nullptr = [](TriangleSharedPointer& t) { return t != nullptr; };
-  for (size_t k =
-           parameters.initial_triangle_count - parameters.final_triangle_count;
-       k > 0; k--) {
-    auto it_null = std::find(begin, end, nullptr);
-    auto it_valid = std::find_if(rbegin, rend, is_not_nullptr);
-    if (it_null > it_valid.base() - 2)
+  size_t free_slot = 0;
+  size_t used_end = parameters.initial_triangle_count;
+  while (true) {
+    while (free_slot < used_end && triangle_slot_used_[free_slot])
+      free_slot++;
+    while (used_end > free_slot && !triangle_slot_used_[used_end - 1])
+      used_end--;
+    if (free_slot >= used_end)
       break;
-    size_t src_i = triangles_.rend() - it_valid - 1;
-    size_t dst_i = it_null - triangles_.begin();
-    *it_null = *it_valid;
-    *it_valid = nullptr;
-    ::CopyTriangleColumnsInMatrix(src_i, dst_i, vertices_, normals_);
-    begin = it_null + 1;
-    rbegin = it_valid + 1;
+    ::CopyTriangleColumnsInMatrix(--used_end, free_slot, vertices_,
+                                  uv_coordinates_, normals_);
+    triangle_slot_used_[free_slot++] = true;
+    triangle_slot_used_[used_end] = false;
   }
+  assert(used_end == parameters.final_triangle_count);
 }
 
 void Space::ResizeVectorAndMatrices(struct UpdateSpaceParameters& parameters) {
-  if (parameters.final_triangle_count == parameters.initial_triangle_count)
+  ReserveTriangles(parameters.final_triangle_count, true);
+}
+
+// Grows the matrices and slots with some headroom when they cannot hold the
+// number of triangles; they are never shrunk
+void Space::ReserveTriangles(size_t triangle_count, bool preserve_content) {
+  size_t reserved = normals_.cols();
+  if (triangle_count <= reserved)
     return;
-  vertices_.conservativeResize(kDimensions,
-                               3 * parameters.final_triangle_count);
-  normals_.conservativeResize(kDimensions, parameters.final_triangle_count);
+  reserved = std::max(triangle_count, reserved + reserved / 2);
+  if (preserve_content) {
+    vertices_.conservativeResize(kDimensions, reserved * kVerticesPerTriangle);
+    uv_coordinates_.conservativeResize(kUVDimensions,
+                                       reserved * kVerticesPerTriangle);
+    normals_.conservativeResize(kDimensions, reserved);
+  } else {
+    vertices_.resize(kDimensions, reserved * kVerticesPerTriangle);
+    uv_coordinates_.resize(kUVDimensions, reserved * kVerticesPerTriangle);
+    normals_.resize(kDimensions, reserved);
+  }
+  triangle_slot_used_.resize(reserved);
 }
 
 void Space::AddRemainingInQueue(struct UpdateSpaceParameters& parameters) {
   size_t last_i = parameters.initial_triangle_count - 1;
   while (!triangle_add_queue_.empty()) {
-    triangles_[++last_i] = triangle_add_queue_.front();
+    triangle_slot_used_[++last_i] = true;
+    ::UpdateMatrixColumnsFromTriangle(last_i, triangle_add_queue_.front(),
+                                      vertices_, uv_coordinates_, normals_);
     triangle_add_queue_.pop();
-    UpdateMatrixColumnsFromTriangle(last_i, triangles_[last_i], vertices_,
-                                    normals_);
-  }
-}
-
-ClippingMask Space::HomogeneousClippingMask(
-    Axis axis,
-    AxisDirection axis_direction) const {
-  return (axis_direction * vertices_.row(axis).array() <=
-          (vertices_.row(kW)).array())
-      .reshaped(kVerticesPerTriangle, triangle_count_)
-      .cast<int>();
-}
-
-void Space::ProcessHomogeneousClippingMask(const ClippingMask& clipping_mask,
-                                           Axis axis,
-                                           AxisDirection axis_direction) {
-  Eigen::Array<int, 1, Eigen::Dynamic> mask_cols_sums =
-      clipping_mask.colwise().sum();
-  // #TODO: can be parallellized
-  for (size_t col = 0; col < static_cast<size_t>(clipping_mask.cols()); col++) {
-    int match_mask_value = 0;
-    TriangleClipMode clip_mode = TriangleClipMode::kExcludeReference;
-    if (mask_cols_sums(col) == 3)
-      continue;
-    EnqueueRemoveTriangle(col);
-    if (mask_cols_sums(col) == 0) {
-      continue;
-    } else if (mask_cols_sums(col) == 1) {
-      clip_mode = TriangleClipMode::kIncludeReference;
-      match_mask_value = 1;
-    }
-    size_t single_vertex_index =
-        ::FindVertexIndexByClipMask(clipping_mask.col(col), match_mask_value);
-    EnqueueAddMultipleTriangles(GetHomogeneousClipSubstitutes(
-        col, single_vertex_index, axis, axis_direction, clip_mode));
   }
 }
 
-// #TODO: refactor!
-void Space::GetInterpolatedVertices(size_t triangle_index,
-                                    size_t single_vertex_index,
-                                    Axis axis,
-                                    AxisDirection axis_direction,
-                                    InterpolatedVertex& iv_ab,
-                                    InterpolatedVertex& iv_ac) const {
-  size_t a, b, c, sorted_a, sorted_b, sorted_c;
-  a = single_vertex_index + triangle_index * kVerticesPerTriangle;
-  b = (a + 1) % kVerticesPerTriangle + triangle_index * kVerticesPerTriangle;
-  c = (a + 2) % kVerticesPerTriangle + triangle_index * kVerticesPerTriangle;
-  Vector4 vector_a = vertices_.block(0, a, kDimensions, 1);
-  Vector4 vector_b = vertices_.block(0, b, kDimensions, 1);
-  Vector4 vector_c = vertices_.block(0, c, kDimensions, 1);
-  iv_ab.vectors = {vector_a, vector_b};
-  iv_ac.vectors = {vector_a, vector_c};
-  std::sort(iv_ab.vectors.begin(), iv_ab.vectors.end(), ::SortClipVertices);
-  std::sort(iv_ac.vectors.begin(), iv_ac.vectors.end(), ::SortClipVertices);
-  TriangleSharedPointer triangle = triangles_[triangle_index];
-  iv_ab.t = ::HomogeneousInterpolation(iv_ab.vectors[0], iv_ab.vectors[1], axis,
-                                       axis_direction);
-  iv_ac.t = ::HomogeneousInterpolation(iv_ac.vectors[0], iv_ac.vectors[1], axis,
-                                       axis_direction);
-  sorted_a = vector_a == iv_ab.vectors[0] ? a % kVerticesPerTriangle
-                                          : b % kVerticesPerTriangle;
-  sorted_b = vector_a == iv_ab.vectors[0] ? b % kVerticesPerTriangle
-                                          : a % kVerticesPerTriangle;
-  iv_ab.uv[0] = triangle->GetVertex(sorted_a).GetUVCoordinate();
-  iv_ab.uv[1] = triangle->GetVertex(sorted_b).GetUVCoordinate();
-  sorted_a = vector_a == iv_ac.vectors[0] ? a % kVerticesPerTriangle
-                                          : c % kVerticesPerTriangle;
-  sorted_c = vector_a == iv_ac.vectors[0] ? c % kVerticesPerTriangle
-                                          : a % kVerticesPerTriangle;
-  iv_ac.uv[0] = triangle->GetVertex(sorted_a).GetUVCoordinate();
-  iv_ac.uv[1] = triangle->GetVertex(sorted_c).GetUVCoordinate();
-}
-
 void Space::Dehomogenize() {
-  vertices_ = (vertices_.array().rowwise() / vertices_.row(3).array()).matrix();
+  auto vertices = vertices_.leftCols(triangle_count_ * kVerticesPerTriangle);
+  vertices = (vertices.array().rowwise() / vertices.row(3).array()).matrix();
 }
\ No newline at end of file
@@ -2,38 +2,81 @@
 #define SPACE_HPP
 
 #include <queue>
+#include "clipper.hpp"
+#include "mesh.hpp"
 #include "triangle.hpp"
+#include "utility/job_system.hpp"
+
+// Output of the fused vertex kernel, one column or element per mesh vertex.
+// Window positions are only meaningful for vertices in front of the camera,
+// which are the only ones of triangles that are not clipped.
+typedef struct ProjectedVertices {
+  VertexMatrix clip_positions;
+  VertexMatrix window_positions;
+  std::vector<Outcode> outcodes;
+} ProjectedVertices;
 
 class Space {
  public:
   Space();
-  void EnqueueAddTriangle(TriangleSharedPointer triangle_ptr);
-  void EnqueueAddMultipleTriangles(
-      std::vector<TriangleSharedPointer> triangles);
+  void SetJobSystem(JobSystem& job_system) noexcept;
+  void EnqueueAddTriangle(const Triangle& triangle);
+  void EnqueueAddMultipleTriangles(const std::vector<Triangle>& triangles);
   void EnqueueRemoveTriangle(size_t index);
+  void EnqueueRemoveMultipleTriangles(const std::vector<size_t>& indices);
   void UpdateSpace();
+  void AssembleTriangles(const Mesh& mesh,
+                         const VertexMatrix& mesh_vertices,
+                         const std::vector<uint32_t>& triangle_indices,
+                         ClipMode clip_mode = ClipMode::kViewVolume);
+  void AssembleProjectedTriangles(
+      const Mesh& mesh,
+      const ProjectedVertices& mesh_vertices,
+      const Matrix4& viewport_matrix,
+      const std::vector<uint32_t>& triangle_indices,
+      const std::vector<bool>& triangle_inside,
+      ClipMode clip_mode = ClipMode::kViewVolume);
   size_t GetTriangleCount() const;
-  const std::array<TriangleSharedPointer, kMaxTriangles>& GetTriangles() const;
-  const VertexMatrix& GetVertices() const;
-  const NormalMatrix& GetNormals() const;
-  std::vector<TriangleSharedPointer> GetHomogeneousClipSubstitutes(
-      size_t triangle_index,
-      size_t solo_vertex,
-      Axis axis,
-      AxisDirection axis_direction,
-      TriangleClipMode clip_mode) const;
-  void ClipAllTriangles(Axis axis, AxisDirection axis_direction);
+  const PipelineStatistics& GetAssemblyStatistics() const noexcept;
+  Triangle GetTriangle(size_t index) const;
+  VertexMatrixView GetVertices() const;
+  UVMatrixView GetUVCoordinates() const;
+  NormalMatrixView GetNormals() const;
+  // Separate passes over the output triangles. The pipeline runs the fused
+  // ProjectVertices over mesh vertices instead; these remain as reference
+  // kernels for tests and benchmarks.
   void TransformVertices(const Matrix4& transformation);
   void TransformNormals(const Matrix4& transformation);
   void Dehomogenize();
 
  private:
-  std::array<TriangleSharedPointer, kMaxTriangles> triangles_;
-  std::queue<TriangleSharedPointer> triangle_add_queue_;
-  std::queue<size_t> triangle_remove_queue_;
+  // Triangle t owns columns 3t..3t+2 of vertices_ and uv_coordinates_,
+  // column t of normals_ and slot t. The matrices and slots only ever grow,
+  // so those past the triangle count are spare capacity reused by the next
+  // frame.
+  std::vector<bool> triangle_slot_used_;
+  std::queue<Triangle> triangle_add_queue_;
+  std::vector<size_t> triangle_remove_queue_;
   size_t triangle_count_ = 0;
   VertexMatrix vertices_;
+  UVMatrix uv_coordinates_;
   NormalMatrix normals_;
+  std::vector<Outcode> vertex_outcodes_;
+  PipelineStatistics assembly_statistics_;
+  JobSystem* job_system_;
+
+  // Clipper and clipped triangles of one chunk of listed triangles, with
+  // the number of triangles each clipped one was split into
+  struct AssemblyChunk {
+    HomogeneousClipper clipper;
+    VertexMatrix clipped_vertices;
+    UVMatrix clipped_uv_coordinates;
+    std::vector<uint8_t> fan_sizes;
+    PipelineStatistics statistics;
+    size_t triangle_count;
+    size_t first_triangle;
+  };
+  std::vector<AssemblyChunk> assembly_chunks_;
 
   struct UpdateSpaceParameters {
     size_t initial_triangle_count;
@@ -42,23 +85,21 @@ class Space {
     size_t remove_queue_size;
   };
 
+  void EmitTriangles(const Mesh& mesh,
+                     const VertexMatrix& clip_vertices,
+                     const std::vector<Outcode>& outcodes,
+                     const VertexMatrix* window_vertices,
+                     const Matrix4& viewport_matrix,
+                     const std::vector<uint32_t>& triangle_indices,
+                     const std::vector<bool>* triangle_inside,
+                     ClipMode clip_mode);
   void InitializeUpdateSpaceParameters(
       struct UpdateSpaceParameters& parameters);
   void ReplaceRemovedWithAdded(struct UpdateSpaceParameters& parameters);
   void DefragmentVectorAndMatrices(struct UpdateSpaceParameters& parameters);
   void ResizeVectorAndMatrices(struct UpdateSpaceParameters& parameters);
+  void ReserveTriangles(size_t triangle_count, bool preserve_content);
   void AddRemainingInQueue(struct UpdateSpaceParameters& parameters);
-  ClippingMask HomogeneousClippingMask(Axis axis,
-                                       AxisDirection axis_direction) const;
-  void ProcessHomogeneousClippingMask(const ClippingMask& clipping_mask,
-                                      Axis axis,
-                                      AxisDirection axis_direction);
-  void GetInterpolatedVertices(size_t triangle_index,
-                               size_t single_vertex_index,
-                               Axis axis,
-                               AxisDirection axis_direction,
-                               InterpolatedVertex& iv_ab,
-                               InterpolatedVertex& iv_ac) const;
 };
 
 #endif
\ No newline at end of file
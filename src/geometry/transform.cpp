@@ -1,5 +1,116 @@
 #include "transform.hpp"
 #include <Eigen/Geometry>
+#include <cstring>
+#include "utility/profiler.hpp"
+#include "utility/simd.hpp"
+
+namespace {
+typedef std::array<Vector4, kNumberOfClippingPlanes> ViewVolumePlanes;
+
+// The view volume in world coordinates, with unit normals pointing inwards.
+// Each plane combines the rows of the clip transform the way the clipper
+// combines the clip coordinates, w plus or minus one of x, y and z.
+ViewVolumePlanes GetViewVolumePlanes(const Matrix4& clip_transform) noexcept {
+  ViewVolumePlanes planes;
+  for (size_t p = 0; p < kNumberOfClippingPlanes; p++) {
+    float axis_direction = p % 2 ? kPositive : kNegative;
+    Vector4 plane = (clip_transform.row(kW) -
+                     axis_direction * clip_transform.row(p / 2))
+                        .transpose();
+    planes[p] = plane / plane.head<3>().norm();
+  }
+  return planes;
+}
+
+// An object is inside when its bounding sphere lies strictly on the inner
+// side of every plane, which leaves its vertices with clear outcodes
+Containment ClassifyObject(const MeshObject& object,
+                           const ViewVolumePlanes& planes) noexcept {
+  Containment containment = Containment::kInside;
+  for (const Vector4& plane : planes) {
+    float distance = plane.head<3>().dot(object.bounding_center) + plane[kW];
+    if (distance < -object.bounding_radius)
+      return Containment::kOutside;
+    if (distance <= object.bounding_radius)
+      containment = Containment::kIntersecting;
+  }
+  return containment;
+}
+
+// Appends the triangles of the range that have the camera behind their
+// plane, which with the winding of the meshes are the ones facing it. The
+// plane equations are evaluated for kSimdWidth triangles at a time and the
+// resulting keep-mask is turned into indices; the last block is padded with
+// null planes, which are never kept.
+void AppendFrontFacingTriangles(const FacePlaneMatrix& planes,
+                                const Vector4& location,
+                                size_t first_triangle,
+                                size_t end_triangle,
+                                std::vector<uint32_t>& triangles) {
+  const FloatBlock location_x = SimdBroadcast(location[kX]);
+  const FloatBlock location_y = SimdBroadcast(location[kY]);
+  const FloatBlock location_z = SimdBroadcast(location[kZ]);
+  const FloatBlock zero = SimdBroadcast(0);
+  alignas(32) float partial_planes[kDimensions][kSimdWidth] = {};
+  for (size_t t = first_triangle; t < end_triangle; t += kSimdWidth) {
+    size_t lanes = std::min(kSimdWidth, end_triangle - t);
+    const float* coefficients[kDimensions];
+    for (size_t c = 0; c < kDimensions; c++) {
+      coefficients[c] = planes.col(c).data() + t;
+      if (lanes < kSimdWidth) {
+        std::memcpy(partial_planes[c], coefficients[c], lanes * sizeof(float));
+        coefficients[c] = partial_planes[c];
+      }
+    }
+    FloatBlock distance = SimdAdd(
+        SimdAdd(SimdAdd(SimdMultiply(SimdLoad(coefficients[kX]), location_x),
+                        SimdMultiply(SimdLoad(coefficients[kY]), location_y)),
+                SimdMultiply(SimdLoad(coefficients[kZ]), location_z)),
+        SimdLoad(coefficients[kW]));
+    int keep_mask = SimdMoveMask(SimdLess(distance, zero));
+    for (; keep_mask; keep_mask &= keep_mask - 1)
+      triangles.push_back(t + __builtin_ctz(keep_mask));
+  }
+}
+
+// Keeps the listed triangles that cover at least kMinScreenTriangleArea
+// square pixels on their front side. That drops degenerate triangles, those
+// turned back-facing by the projection of nearly edge-on faces, and slivers
+// smaller than a pixel, which may still cover a pixel center. Triangles with
+// a vertex outside the depth planes have no window positions yet and are left
+// to clipping. The inside flags are kept in step with the triangles. Returns
+// the number of triangles dropped.
+size_t RemoveSmallTriangles(const TriangleIndexMatrix& indices,
+                            const ProjectedVertices& projected_vertices,
+                            std::vector<uint32_t>& triangles,
+                            std::vector<bool>& triangle_inside) {
+  const VertexMatrix& positions = projected_vertices.window_positions;
+  const std::vector<Outcode>& outcodes = projected_vertices.outcodes;
+  size_t kept = 0;
+  for (size_t i = 0; i < triangles.size(); i++) {
+    uint32_t t = triangles[i];
+    uint32_t a = indices(0, t), b = indices(1, t), c = indices(2, t);
+    if ((outcodes[a] | outcodes[b] | outcodes[c]) & kDepthPlanes) {
+      triangle_inside[kept] = triangle_inside[i];
+      triangles[kept++] = t;
+      continue;
+    }
+    float double_area =
+        (positions(kX, b) - positions(kX, a)) *
+            (positions(kY, c) - positions(kY, a)) -
+        (positions(kX, c) - positions(kX, a)) *
+            (positions(kY, b) - positions(kY, a));
+    if (kFrontFacingAreaSign * double_area >= 2 * kMinScreenTriangleArea) {
+      triangle_inside[kept] = triangle_inside[i];
+      triangles[kept++] = t;
+    }
+  }
+  size_t removed = triangles.size() - kept;
+  triangles.resize(kept);
+  triangle_inside.resize(kept);
+  return removed;
+}
+}  // namespace
 
 Transform::Transform() : matrix_(Matrix4::Zero()) {};
 
@@ -183,10 +294,47 @@ bool ViewportTransform::operator==(const ViewportTransform& rhs) const {
   return true;
 }
 
+// One pass over each vertex instead of one pass over the whole matrix per
+// step, as the separate Space kernels did
+void ProjectVertices(const VertexMatrix& vertices,
+                     const Matrix4& clip_transform,
+                     const Matrix4& viewport_matrix,
+                     const std::vector<Containment>& chunk_containment,
+                     JobSystem& job_system,
+                     ProjectedVertices& projected_vertices) {
+  const size_t vertex_count = vertices.cols();
+  projected_vertices.clip_positions.resize(kDimensions, vertex_count);
+  projected_vertices.window_positions.resize(kDimensions, vertex_count);
+  projected_vertices.outcodes.resize(vertex_count);
+  size_t chunk_count = (vertex_count + kVertexChunkSize - 1) / kVertexChunkSize;
+  assert(chunk_containment.size() == chunk_count);
+  job_system.ParallelFor(chunk_count, [&](size_t chunk) {
+    if (chunk_containment[chunk] == Containment::kOutside)
+      return;
+    bool inside = chunk_containment[chunk] == Containment::kInside;
+    size_t end = std::min(vertex_count, (chunk + 1) * kVertexChunkSize);
+    for (size_t v = chunk * kVertexChunkSize; v < end; v++) {
+      Vector4 clip_position = clip_transform * vertices.col(v);
+      projected_vertices.clip_positions.col(v) = clip_position;
+      projected_vertices.outcodes[v] =
+          inside ? 0 : HomogeneousClipper::GetOutcode(clip_position);
+      projected_vertices.window_positions.col(v) =
+          viewport_matrix * (clip_position / clip_position[kW]);
+    }
+  });
+}
+
 TransformPipeline::TransformPipeline(CameraTransform& camera,
                                      PerspectiveProjection& perspective,
                                      ViewportTransform& viewport)
-    : camera_(camera), perspective_(perspective), viewport_(viewport) {}
+    : camera_(camera),
+      perspective_(perspective),
+      viewport_(viewport),
+      job_system_(&JobSystem::GetInstance()),
+      clip_mode_(ClipMode::kViewVolume),
+      screen_space_culling_(false),
+      statistics_{},
+      front_output_(0) {}
 
 CameraTransform& TransformPipeline::GetCameraTransform() {
   return camera_;
@@ -200,32 +348,125 @@ ViewportTransform& TransformPipeline::GetViewportTransform() {
   return viewport_;
 }
 
-void TransformPipeline::RunPipeline(const Space& input_space) {
-  output_space_ = input_space;
+// The guard band trades geometric clipping against the X/Y planes for
+// scissoring in the rasterizers
+void TransformPipeline::SetClipMode(ClipMode clip_mode) noexcept {
+  clip_mode_ = clip_mode;
+}
+
+// Off by default, as dropping subpixel triangles may leave pixels unwritten
+void TransformPipeline::SetScreenSpaceCulling(bool enabled) noexcept {
+  screen_space_culling_ = enabled;
+}
+
+void TransformPipeline::SetJobSystem(JobSystem& job_system) noexcept {
+  job_system_ = &job_system;
+  for (Space& output_space : output_spaces_)
+    output_space.SetJobSystem(job_system);
+}
 
-  // Back-face culling
-  const Vector4 location = camera_.GetCamera().GetLocation().GetVector();
-  for (size_t t = 0; t < output_space_.GetTriangleCount(); t++) {
-    const Vertex& vertex = output_space_.GetTriangles()[t]->GetVertex(0);
-    const Vector4& normal = output_space_.GetTriangles()[t]->GetNormal();
-    if ((vertex - location).dot(normal) <= 0)
-      output_space_.EnqueueRemoveTriangle(t);
+void TransformPipeline::RunPipeline(const Mesh& input_mesh) {
+  PrepareOutput(input_mesh);
+  SwapOutputs();
+}
+
+void TransformPipeline::PrepareOutput(const Mesh& input_mesh) {
+  PROFILE_ZONE("RunPipeline");
+  Space& output_space = output_spaces_[1 - front_output_];
+  PipelineStatistics& statistics = statistics_[1 - front_output_];
+  const VertexMatrix& vertices = input_mesh.GetVertices();
+  const Matrix4 clip_transform = perspective_.GetMatrix() * camera_.GetMatrix();
+  size_t frustum_culled;
+  {
+    PROFILE_ZONE("FrustumCull");
+    frustum_culled = CullObjects(input_mesh, clip_transform);
   }
-  output_space_.UpdateSpace();
-
-  // #TODO: optimize by giving as two arguments rather than ready product
-  output_space_.TransformVertices(perspective_.GetMatrix() *
-                                  camera_.GetMatrix());
-  for (Axis axis : {Axis::kX, Axis::kY, Axis::kZ}) {
-    for (AxisDirection axis_direction :
-         {AxisDirection::kNegative, AxisDirection::kPositive}) {
-      output_space_.ClipAllTriangles(axis, axis_direction);
+  {
+    PROFILE_ZONE("BackFaceCull");
+    const Vector4 location = camera_.GetCamera().GetLocation().GetVector();
+    visible_triangles_.clear();
+    visible_triangle_inside_.clear();
+    for (uint32_t o : visible_objects_) {
+      const MeshObject& object = input_mesh.GetObjects()[o];
+      ::AppendFrontFacingTriangles(
+          input_mesh.GetFacePlanes(), location, object.first_triangle,
+          object.first_triangle + object.triangle_count, visible_triangles_);
+      visible_triangle_inside_.resize(
+          visible_triangles_.size(),
+          object_containment_[o] == Containment::kInside);
     }
   }
-  output_space_.Dehomogenize();
-  output_space_.TransformVertices(viewport_.GetMatrix());
+  size_t back_face_culled = input_mesh.GetTriangleCount() - frustum_culled -
+                            visible_triangles_.size();
+
+  // Shared vertices are transformed once; assembly then rejects, accepts or
+  // clips every triangle in a single pass
+  {
+    PROFILE_ZONE("ProjectVertices");
+    ::ProjectVertices(vertices, clip_transform, viewport_.GetMatrix(),
+                      vertex_chunk_containment_, *job_system_,
+                      projected_vertices_);
+  }
+  size_t screen_culled = 0;
+  if (screen_space_culling_) {
+    PROFILE_ZONE("ScreenSpaceCull");
+    screen_culled = ::RemoveSmallTriangles(
+        input_mesh.GetIndices(), projected_vertices_, visible_triangles_,
+        visible_triangle_inside_);
+  }
+  output_space.AssembleProjectedTriangles(
+      input_mesh, projected_vertices_, viewport_.GetMatrix(),
+      visible_triangles_, visible_triangle_inside_, clip_mode_);
+  statistics = output_space.GetAssemblyStatistics();
+  statistics.input_triangles = input_mesh.GetTriangleCount();
+  statistics.frustum_culled = frustum_culled;
+  statistics.back_face_culled = back_face_culled;
+  statistics.screen_culled = screen_culled;
+}
+
+// Rejects the objects whose bounding sphere lies outside of a plane of the
+// view volume, so that none of their triangles is tested, transformed or
+// assembled, and records for each vertex chunk how the objects referencing it
+// lie. Objects inside the view volume need no further test: the vertex kernel
+// skips the outcodes of the chunks that only they reference, and assembly
+// accepts their triangles without combining outcodes or clipping.
+// Returns the number of triangles in the rejected objects.
+size_t TransformPipeline::CullObjects(const Mesh& mesh,
+                                      const Matrix4& clip_transform) {
+  const ViewVolumePlanes planes = ::GetViewVolumePlanes(clip_transform);
+  const std::vector<MeshObject>& objects = mesh.GetObjects();
+  size_t culled = 0;
+  visible_objects_.clear();
+  object_containment_.resize(objects.size());
+  vertex_chunk_containment_.assign(
+      (mesh.GetVertexCount() + kVertexChunkSize - 1) / kVertexChunkSize,
+      Containment::kOutside);
+  for (size_t o = 0; o < objects.size(); o++) {
+    const MeshObject& object = objects[o];
+    Containment containment = ::ClassifyObject(object, planes);
+    object_containment_[o] = containment;
+    if (containment == Containment::kOutside) {
+      culled += object.triangle_count;
+      continue;
+    }
+    visible_objects_.push_back(o);
+    size_t end_vertex = object.first_vertex + object.vertex_count;
+    for (size_t chunk = object.first_vertex / kVertexChunkSize;
+         chunk * kVertexChunkSize < end_vertex; chunk++)
+      vertex_chunk_containment_[chunk] =
+          std::max(vertex_chunk_containment_[chunk], containment);
+  }
+  return culled;
+}
+
+void TransformPipeline::SwapOutputs() noexcept {
+  front_output_ = 1 - front_output_;
+}
+
+const PipelineStatistics& TransformPipeline::GetStatistics() const noexcept {
+  return statistics_[front_output_];
 }
 
 const Space& TransformPipeline::GetOutputSpace() const {
-  return output_space_;
+  return output_spaces_[front_output_];
 }
\ No newline at end of file
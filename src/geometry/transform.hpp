@@ -6,6 +6,7 @@
 #include "common.hpp"
 #include "point.hpp"
 #include "space.hpp"
+#include "utility/job_system.hpp"
 
 class Transform {
  public:
@@ -76,6 +77,22 @@ class ViewportTransform : public Transform {
   int16_t x_offset_, y_offset_;
 };
 
+// Fused vertex kernel of the pipeline: the clip transform, the outcode, the
+// perspective divide and the viewport transform in one pass over each vertex.
+// Chunks of kVertexChunkSize vertices are processed in parallel; those
+// outside the view volume are skipped and keep stale values, and those inside
+// it get clear outcodes without a test.
+void ProjectVertices(const VertexMatrix& vertices,
+                     const Matrix4& clip_transform,
+                     const Matrix4& viewport_matrix,
+                     const std::vector<Containment>& chunk_containment,
+                     JobSystem& job_system,
+                     ProjectedVertices& projected_vertices);
+
+// The output is double buffered. RunPipeline combines PrepareOutput, which
+// writes the back buffer, with SwapOutputs, which makes it the front buffer.
+// Calling them separately lets the front buffer of one frame be rasterized
+// while the next frame is prepared on another thread.
 class TransformPipeline {
  public:
   TransformPipeline() = delete;
@@ -85,14 +102,33 @@ class TransformPipeline {
   CameraTransform& GetCameraTransform();
   PerspectiveProjection& GetPerspectiveProjection();
   ViewportTransform& GetViewportTransform();
-  void RunPipeline(const Space& input_space);
+  void SetClipMode(ClipMode clip_mode) noexcept;
+  void SetScreenSpaceCulling(bool enabled) noexcept;
+  void SetJobSystem(JobSystem& job_system) noexcept;
+  void RunPipeline(const Mesh& input_mesh);
+  void PrepareOutput(const Mesh& input_mesh);
+  void SwapOutputs() noexcept;
   const Space& GetOutputSpace() const;
+  const PipelineStatistics& GetStatistics() const noexcept;
 
  private:
+  size_t CullObjects(const Mesh& mesh, const Matrix4& clip_transform);
+
   CameraTransform& camera_;
   PerspectiveProjection& perspective_;
   ViewportTransform& viewport_;
-  Space output_space_;
+  JobSystem* job_system_;
+  ClipMode clip_mode_;
+  bool screen_space_culling_;
+  std::vector<uint32_t> visible_objects_;
+  std::vector<Containment> object_containment_;
+  std::vector<Containment> vertex_chunk_containment_;
+  std::vector<uint32_t> visible_triangles_;
+  std::vector<bool> visible_triangle_inside_;
+  ProjectedVertices projected_vertices_;
+  std::array<Space, 2> output_spaces_;
+  std::array<PipelineStatistics, 2> statistics_;
+  size_t front_output_;
 };
 
 #endif
\ No newline at end of file
@@ -21,7 +21,7 @@ Triangle::Triangle(Vertex vertex_1,
 /* #TODO: Constructing Triangle with zero area
    -> could be dealt by setting normal to null */
 
-Vertex Triangle::GetVertex(size_t index) const {
+const Vertex& Triangle::GetVertex(size_t index) const {
   assert(index < 3);
   return vertices_[index];
 }
@@ -14,7 +14,7 @@ class Triangle {
            Vertex vertex_2,
            Vertex vertex_3,
            Direction normal);
-  Vertex GetVertex(size_t index) const;
+  const Vertex& GetVertex(size_t index) const;
   const Vector4& GetNormal() const;
 
  private:
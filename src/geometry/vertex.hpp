@@ -5,12 +5,6 @@
 #include "point.hpp"
 #include "uv_coordinate.hpp"
 
-typedef struct InterpolatedVertex {
-  std::array<Vector4, 2> vectors;
-  std::array<UVCoordinate, 2> uv;
-  float t;
-} InterpolatedVertex;
-
 class Vertex : public Point {
  public:
   Vertex();
@@ -20,11 +14,10 @@ class Vertex : public Point {
   Vertex(Point& point);
   Vertex(const Vector4& vector, const UVCoordinate& uv_coordinate) noexcept;
   Vertex(const Vertex& vertex, const UVCoordinate& uv_coordinate) noexcept;
-  Vertex(const InterpolatedVertex& iv) noexcept;
   const UVCoordinate GetUVCoordinate() const noexcept;
 
  private:
   UVCoordinate uv_coordinate_;
 };
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -1,54 +1,319 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
 
 #include "server/game_state.hpp"
 #include "ui/controller.hpp"
 #include "ui/rasterizer.hpp"
 #include "ui/ui.hpp"
+#include "utility/benchmark.hpp"
+#include "utility/job_system.hpp"
+#include "utility/profiler.hpp"
+#include "utility/resolution_scaler.hpp"
 #include "utility/timer.hpp"
 
-int main(int argc, char** argv) {
-  std::cout << "Hello, this is Software Renderer.\n\n";
+namespace {
+constexpr const char* kDefaultScene = "assets/scenes/uv_teapot.obj";
+constexpr const char* kDefaultRasterizer = "tiled";
+constexpr const char* kDefaultBenchmarkOutput = "benchmark.json";
+constexpr int kDefaultTraceFrames = 60;
 
-  int max_ticks = -1;
-  if (argc > 2)
-    if (!std::strcmp(argv[1], "--maxticks"))
-      std::sscanf(argv[2], "%d", &max_ticks);
+void PrintUsage(const char* program) {
+  std::cout << "Usage: " << program << " [--maxticks <ticks>]"
+            << " [--scene <obj file>] [--rasterizer <name>]"
+            << " [--framebudget <ms>]\n"
+            << "       " << program << " --benchmark <camera path>"
+            << " [--scene <obj file>] [--rasterizer <name>]"
+            << " [--output <json file>]\n"
+            << "Both modes take [--resolution <width>x<height>],"
+            << " [--pipelined <0|1>], [--screencull <0|1>],"
+            << " [--guardband <0|1>], and"
+            << " [--trace <json file>] [--traceframes <frames>]"
+            << " in builds with profiler=1.\n"
+            << "Rasterizers: wireframe, scanline, flat, edge, textured,"
+            << " tiled, overdraw, depthcomplexity\n"
+            << "Tab cycles through the chosen rasterizer, wireframe and the"
+            << " two heat maps.\n"
+            << "A frame budget lowers the internal resolution while frames"
+            << " take longer and raises it again when there is headroom.\n";
+}
+
+#ifdef ENABLE_PROFILER
+// Writes the frames captured from the start of the run as Chrome trace events
+int WriteTrace(const char* trace_filename) {
+  std::ofstream output_file_stream(trace_filename);
+  if (!output_file_stream) {
+    std::cerr << trace_filename << ": could not be opened for writing\n";
+    return 1;
+  }
+  Profiler::GetInstance().WriteTraceEvents(output_file_stream);
+  std::cout << "Wrote trace to " << trace_filename << ".\n";
+  return 0;
+}
+#endif
+
+// Returns nullptr for unknown names
+std::unique_ptr<Rasterizer> CreateRasterizer(const std::string& name) {
+  if (name == "wireframe")
+    return std::make_unique<WireframeRasterizer>();
+  if (name == "scanline")
+    return std::make_unique<ScanlineRasterizer>();
+  if (name == "flat")
+    return std::make_unique<FlatRasterizer>();
+  if (name == "edge")
+    return std::make_unique<EdgeFunctionRasterizer>();
+  if (name == "textured")
+    return std::make_unique<TexturedRasterizer>();
+  if (name == "tiled")
+    return std::make_unique<TiledRasterizer>();
+  if (name == "overdraw")
+    return std::make_unique<OverdrawRasterizer>(HeatmapMetric::kFragmentWrites);
+  if (name == "depthcomplexity")
+    return std::make_unique<OverdrawRasterizer>(HeatmapMetric::kDepthTests);
+  return nullptr;
+}
 
-  UserInterface user_interface;
-  // BenchmarkInterface user_interface;
+// Renders every frame of the camera path without opening a window and writes
+// the frame timings as JSON. When pipelined, the geometry of the next frame
+// is processed as a job while the current one is rasterized, and
+// the pipeline time of a frame is the one of the geometry it overlapped.
+int RunBenchmark(const BenchmarkSettings& settings,
+                 Rasterizer& rasterizer,
+                 const char* output_filename) {
+  CameraPath camera_path;
+  try {
+    camera_path.LoadFromFile(settings.camera_path.c_str());
+  } catch (const CameraPathException& e) {
+    std::cerr << settings.camera_path << ": " << e.what() << "\n";
+    return 1;
+  }
+  GameState game_state(settings.scene.c_str());
+  game_state.SetResolution(settings.width, settings.height);
+  game_state.SetScreenSpaceCulling(settings.screen_space_culling);
+  game_state.SetClipMode(settings.guard_band ? ClipMode::kGuardBand
+                                             : ClipMode::kViewVolume);
+  auto user_interface =
+      std::make_unique<BenchmarkInterface>(settings.width, settings.height);
+  BenchmarkReport report(settings);
+  Timer frame_timer("frame");
+  Timer pipeline_timer("pipeline");
+  Timer rasterization_timer("rasterization");
+  const auto prepare_tick = [&game_state, &pipeline_timer] {
+    pipeline_timer.Start();
+    game_state.PrepareTick();
+    pipeline_timer.Stop(false);
+  };
+  JobSystem& job_system = JobSystem::GetInstance();
+  JobCounter next_tick;
+  if (settings.pipelined) {
+    game_state.SetCamera(camera_path.GetCamera(0));
+    game_state.ProcessTick();
+  }
+  for (size_t frame = 0; frame < camera_path.GetFrameCount(); frame++) {
+    frame_timer.Start();
+    if (settings.pipelined) {
+      game_state.SetCamera(camera_path.GetCamera(frame + 1));
+      job_system.Submit(prepare_tick, next_tick);
+    } else {
+      game_state.SetCamera(camera_path.GetCamera(frame));
+      prepare_tick();
+      game_state.PublishTick();
+    }
+    rasterization_timer.Start();
+    rasterizer.RasterizeGameState(game_state, *user_interface);
+    user_interface->RenderPresent();
+    rasterization_timer.Stop(false);
+    job_system.Wait(next_tick);
+    frame_timer.Stop(false);
+    PROFILE_END_FRAME();
+    report.AddFrame({pipeline_timer.GetDuration(),
+                     rasterization_timer.GetDuration(),
+                     frame_timer.GetDuration(),
+                     game_state.GetOutputSpace().GetTriangleCount(),
+                     game_state.GetPipelineStatistics(),
+                     rasterizer.GetStatistics()});
+    if (settings.pipelined)
+      game_state.PublishTick();
+  }
+  std::ofstream output_file_stream(output_filename);
+  if (!output_file_stream) {
+    std::cerr << output_filename << ": could not be opened for writing\n";
+    return 1;
+  }
+  report.WriteJson(output_file_stream);
+  std::cout << "Wrote " << camera_path.GetFrameCount() << " frames to "
+            << output_filename << ".\n";
+  return 0;
+}
+
+// A positive frame budget enables dynamic resolution scaling. When pipelined,
+// the tick shown lags the input by one frame, and a new render size only
+// applies once the geometry processed at that size is shown.
+int RunInteractive(const BenchmarkSettings& settings,
+                   Rasterizer& rasterizer,
+                   int max_ticks,
+                   float frame_budget_ms) {
+  UserInterface user_interface(settings.width, settings.height, true);
   Controller controller;
-  GameState game_state;
-  WireframeRasterizer wirefreame_rasterizer;
-  // FlatRasterizer rasterizer;
-  TexturedRasterizer rasterizer;
-  Rasterizer* active_rasterizer = &rasterizer;
+  GameState game_state(settings.scene.c_str());
+  game_state.SetResolution(settings.width, settings.height);
+  game_state.SetScreenSpaceCulling(settings.screen_space_culling);
+  game_state.SetClipMode(settings.guard_band ? ClipMode::kGuardBand
+                                             : ClipMode::kViewVolume);
+  auto wireframe_rasterizer = std::make_unique<WireframeRasterizer>();
+  auto overdraw_rasterizer =
+      std::make_unique<OverdrawRasterizer>(HeatmapMetric::kFragmentWrites);
+  auto depth_complexity_rasterizer =
+      std::make_unique<OverdrawRasterizer>(HeatmapMetric::kDepthTests);
+  const std::array<Rasterizer*, 4> rasterizers = {
+      &rasterizer, wireframe_rasterizer.get(), overdraw_rasterizer.get(),
+      depth_complexity_rasterizer.get()};
+  size_t active_rasterizer = 0;
+  ResolutionScaler resolution_scaler(frame_budget_ms);
+  uint16_t render_width = settings.width;
+  uint16_t render_height = settings.height;
+  const auto prepare_tick = [&game_state] { game_state.PrepareTick(); };
+  JobSystem& job_system = JobSystem::GetInstance();
+  JobCounter next_tick;
+  Timer frame_timer("frame");
   Timer timer("main()");
   timer.Start();
+  if (settings.pipelined)
+    game_state.ProcessTick();
 
   while (true) {
+    frame_timer.Start();
     controller.UpdateState();
     if (controller.CheckQuitRequest()) {
       std::cout << "Ticks: " << game_state.GetTick() << "\n";
       break;
     }
     if (controller.ConsumeToggleRasterizerRequest()) {
+      frame_timer.Pause();
       SDL_Delay(100);
-      if (active_rasterizer == &rasterizer)
-        active_rasterizer = &wirefreame_rasterizer;
-      else
-        active_rasterizer = &rasterizer;
+      frame_timer.Continue();
+      active_rasterizer = (active_rasterizer + 1) % rasterizers.size();
     }
     game_state.UpdatePlayerState(controller);
-    game_state.ProcessTick();
-    active_rasterizer->RasterizeGameState(game_state, user_interface);
+    if (settings.pipelined)
+      job_system.Submit(prepare_tick, next_tick);
+    else
+      game_state.ProcessTick();
+    rasterizers[active_rasterizer]->RasterizeGameState(game_state,
+                                                       user_interface);
     user_interface.RenderPresent();
+    if (settings.pipelined) {
+      job_system.Wait(next_tick);
+      game_state.PublishTick();
+      user_interface.SetRenderSize(render_width, render_height);
+    }
+    PROFILE_END_FRAME();
     if (max_ticks > 0 &&
         game_state.GetTick() > static_cast<uint64_t>(max_ticks))
       break;
+    frame_timer.Stop(false);
+    if (frame_budget_ms > 0 &&
+        resolution_scaler.AddFrame(frame_timer.GetDuration())) {
+      render_width = resolution_scaler.GetScaledSize(settings.width);
+      render_height = resolution_scaler.GetScaledSize(settings.height);
+      game_state.SetResolution(render_width, render_height);
+      if (!settings.pipelined)
+        user_interface.SetRenderSize(render_width, render_height);
+    }
   }
 
   timer.Stop(false);
   std::cout << "Mean FPS: " << game_state.GetTick() * 1000 / timer.GetDuration()
             << "\n";
+  if (frame_budget_ms > 0)
+    std::cout << "Final render scale: " << resolution_scaler.GetScale()
+              << "\n";
   return 0;
-}
\ No newline at end of file
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  int max_ticks = -1;
+  BenchmarkSettings settings = {kDefaultScene, "", kDefaultRasterizer,
+                                kDefaultWindowWidth, kDefaultWindowHeight, false,
+                                false, false};
+  const char* output_filename = kDefaultBenchmarkOutput;
+  const char* trace_filename = nullptr;
+  int trace_frames = kDefaultTraceFrames;
+  float frame_budget_ms = 0;
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 == argc) {
+      ::PrintUsage(argv[0]);
+      return 1;
+    }
+    if (!std::strcmp(argv[i], "--maxticks"))
+      std::sscanf(argv[i + 1], "%d", &max_ticks);
+    else if (!std::strcmp(argv[i], "--benchmark"))
+      settings.camera_path = argv[i + 1];
+    else if (!std::strcmp(argv[i], "--scene"))
+      settings.scene = argv[i + 1];
+    else if (!std::strcmp(argv[i], "--rasterizer"))
+      settings.rasterizer = argv[i + 1];
+    else if (!std::strcmp(argv[i], "--output"))
+      output_filename = argv[i + 1];
+    else if (!std::strcmp(argv[i], "--trace"))
+      trace_filename = argv[i + 1];
+    else if (!std::strcmp(argv[i], "--traceframes"))
+      std::sscanf(argv[i + 1], "%d", &trace_frames);
+    else if (!std::strcmp(argv[i], "--pipelined"))
+      settings.pipelined = std::strcmp(argv[i + 1], "0");
+    else if (!std::strcmp(argv[i], "--screencull"))
+      settings.screen_space_culling = std::strcmp(argv[i + 1], "0");
+    else if (!std::strcmp(argv[i], "--guardband"))
+      settings.guard_band = std::strcmp(argv[i + 1], "0");
+    else if (!std::strcmp(argv[i], "--framebudget"))
+      std::sscanf(argv[i + 1], "%f", &frame_budget_ms);
+    else if (!std::strcmp(argv[i], "--resolution")) {
+      if (std::sscanf(argv[i + 1], "%hux%hu", &settings.width,
+                      &settings.height) != 2 ||
+          !settings.width || !settings.height ||
+          settings.width > kMaxWindowSize || settings.height > kMaxWindowSize) {
+        ::PrintUsage(argv[0]);
+        return 1;
+      }
+    } else {
+      ::PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  std::unique_ptr<Rasterizer> rasterizer =
+      ::CreateRasterizer(settings.rasterizer);
+  if (!rasterizer) {
+    ::PrintUsage(argv[0]);
+    return 1;
+  }
+
+#ifdef ENABLE_PROFILER
+  if (trace_filename)
+    Profiler::GetInstance().StartCapture(std::max(trace_frames, 0));
+#else
+  if (trace_filename) {
+    std::cerr << "Tracing requires a build with profiler=1.\n";
+    return 1;
+  }
+#endif
+
+  int status;
+  if (!settings.camera_path.empty()) {
+    status = ::RunBenchmark(settings, *rasterizer, output_filename);
+  } else {
+    std::cout << "Hello, this is Software Renderer.\n\n";
+    status = ::RunInteractive(settings, *rasterizer, max_ticks,
+                              frame_budget_ms);
+  }
+#ifdef ENABLE_PROFILER
+  Profiler::GetInstance().PrintZoneStatistics();
+  if (trace_filename && !status)
+    status = ::WriteTrace(trace_filename);
+#endif
+  return status;
+}
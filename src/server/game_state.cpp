@@ -1,18 +1,37 @@
 #include "game_state.hpp"
 #include "utility/geometry_importer.hpp"
+#include "utility/profiler.hpp"
 
-GameState::GameState()
+GameState::GameState() : GameState("assets/scenes/uv_teapot.obj") {}
+
+GameState::GameState(const char* scene_filename) : GameState(Mesh()) {
+  ObjGeometryImporter obj_importer(world_mesh_);
+  obj_importer.ImportGeometryFromFile(scene_filename);
+}
+
+GameState::GameState(const Mesh& world_mesh)
     : camera_transform_(player_),
       perspective_(1, 10, -1, 1, 1, -1),
-      viewport_(kWindowWidth, kWindowHeight),
+      viewport_(kDefaultWindowWidth, kDefaultWindowHeight),
       pipeline_(camera_transform_, perspective_, viewport_),
-      tick_counter_(0) {
-  ObjGeometryImporter obj_importer(world_space_);
-  obj_importer.ImportGeometryFromFile("assets/scenes/uv_teapot.obj");
-}
+      world_mesh_(world_mesh),
+      tick_counter_(0) {}
 
 void GameState::ProcessTick() noexcept {
-  pipeline_.RunPipeline(world_space_);
+  PrepareTick();
+  PublishTick();
+}
+
+// Runs the pipeline into the back buffer of its output. The output space and
+// statistics of the previous tick stay readable meanwhile, but the camera,
+// the projection and the viewport must not change until it returns.
+void GameState::PrepareTick() noexcept {
+  PROFILE_ZONE("ProcessTick");
+  pipeline_.PrepareOutput(world_mesh_);
+}
+
+void GameState::PublishTick() noexcept {
+  pipeline_.SwapOutputs();
   tick_counter_++;
 }
 
@@ -36,10 +55,41 @@ void GameState::UpdatePlayerState(const Controller& controller) noexcept {
   camera_transform_.UpdateTransform();
 }
 
+// Replaces the player-controlled camera, e.g. for scripted camera paths
+void GameState::SetCamera(const Camera& camera) noexcept {
+  camera_transform_.GetCamera() = camera;
+  camera_transform_.UpdateTransform();
+}
+
+// The vertical field of view is kept and the horizontal one follows the
+// aspect ratio
+void GameState::SetResolution(uint16_t width, uint16_t height) noexcept {
+  float aspect_ratio = static_cast<float>(width) / height;
+  perspective_ = PerspectiveProjection(1, 10, -aspect_ratio, aspect_ratio, 1,
+                                       -1);
+  viewport_ = ViewportTransform(width, height);
+}
+
+void GameState::SetScreenSpaceCulling(bool enabled) noexcept {
+  pipeline_.SetScreenSpaceCulling(enabled);
+}
+
+void GameState::SetClipMode(ClipMode clip_mode) noexcept {
+  pipeline_.SetClipMode(clip_mode);
+}
+
+void GameState::SetJobSystem(JobSystem& job_system) noexcept {
+  pipeline_.SetJobSystem(job_system);
+}
+
 const Space& GameState::GetOutputSpace() const noexcept {
   return pipeline_.GetOutputSpace();
 }
 
+const PipelineStatistics& GameState::GetPipelineStatistics() const noexcept {
+  return pipeline_.GetStatistics();
+}
+
 uint64_t GameState::GetTick() const noexcept {
   return tick_counter_;
 }
\ No newline at end of file
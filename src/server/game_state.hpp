@@ -1,6 +1,7 @@
 #ifndef GAME_STATE_HPP
 #define GAME_STATE_HPP
 
+#include "geometry/mesh.hpp"
 #include "geometry/space.hpp"
 #include "geometry/transform.hpp"
 #include "server/player.hpp"
@@ -9,9 +10,19 @@
 class GameState {
  public:
   GameState();
+  GameState(const char* scene_filename);
+  GameState(const Mesh& world_mesh);
   void ProcessTick() noexcept;
+  void PrepareTick() noexcept;
+  void PublishTick() noexcept;
   void UpdatePlayerState(const Controller& controller) noexcept;
+  void SetCamera(const Camera& camera) noexcept;
+  void SetResolution(uint16_t width, uint16_t height) noexcept;
+  void SetScreenSpaceCulling(bool enabled) noexcept;
+  void SetClipMode(ClipMode clip_mode) noexcept;
+  void SetJobSystem(JobSystem& job_system) noexcept;
   const Space& GetOutputSpace() const noexcept;
+  const PipelineStatistics& GetPipelineStatistics() const noexcept;
   uint64_t GetTick() const noexcept;
 
  private:
@@ -20,7 +31,7 @@ class GameState {
   PerspectiveProjection perspective_;
   ViewportTransform viewport_;
   TransformPipeline pipeline_;
-  Space world_space_;
+  Mesh world_mesh_;
   uint64_t tick_counter_;
 };
 
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <random>
+
+#include "server/game_state.hpp"
+#include "utility/job_system.hpp"
+
+// glibc entry points of the allocator that the replacements below wrap
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+}
+
+namespace {
+// Counts the allocations of every thread while enabled
+std::atomic<bool> counting_allocations(false);
+std::atomic<size_t> allocation_count(0);
+
+void CountAllocation() noexcept {
+  if (counting_allocations.load(std::memory_order_relaxed))
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+}
+}  // namespace
+
+// Allocations are counted at the C allocator, which both operator new and
+// the aligned allocator of Eigen matrices end up calling. Operator new itself
+// is left alone, so every new and delete in the binary stays paired with the
+// library's own matching overload.
+extern "C" {
+void* malloc(size_t size) noexcept {
+  CountAllocation();
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+  CountAllocation();
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) noexcept {
+  CountAllocation();
+  return __libc_realloc(pointer, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+  CountAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** pointer, size_t alignment, size_t size) noexcept {
+  CountAllocation();
+  *pointer = __libc_memalign(alignment, size);
+  return *pointer ? 0 : errno;
+}
+
+void free(void* pointer) noexcept {
+  __libc_free(pointer);
+}
+}
+
+// Small triangles scattered all around the camera, so that each tick culls,
+// clips and assembles some of them on several threads
+TEST(Allocation, SteadyStateTicksDoNotAllocate) {
+  Mesh world_mesh;
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<float> position(-6, 6);
+  std::uniform_real_distribution<float> offset(-1, 1);
+  for (size_t i = 0; i < 4 * kAssemblyChunkSize; i++) {
+    Vector3 a(position(generator), position(generator), position(generator));
+    Vector3 b = a + Vector3(offset(generator), offset(generator), 0);
+    Vector3 c = a + Vector3(0, offset(generator), offset(generator));
+    world_mesh.EnqueueAddTriangle(Triangle(Vertex(a), Vertex(b), Vertex(c)));
+  }
+  world_mesh.UpdateMesh();
+  JobSystem job_system(4);
+  GameState game_state(world_mesh);
+  game_state.SetJobSystem(job_system);
+  game_state.SetCamera(Camera({0.5, 0.2, 0.1}, 0.3, 0.2, 0));
+  // Both output spaces and every scratch buffer reach their final size
+  for (size_t tick = 0; tick < 4; tick++)
+    game_state.ProcessTick();
+  ASSERT_GT(game_state.GetOutputSpace().GetTriangleCount(), 0);
+
+  counting_allocations = true;
+  for (size_t tick = 0; tick < 8; tick++)
+    game_state.ProcessTick();
+  counting_allocations = false;
+  EXPECT_EQ(0, allocation_count);
+}
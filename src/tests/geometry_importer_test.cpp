@@ -4,13 +4,16 @@
 
 class ObjGeometryImporterTest : public testing::Test {
  protected:
-  ObjGeometryImporterTest() : obj_importer_(space_) {}
+  ObjGeometryImporterTest()
+      : obj_importer_(mesh_, kTestMaxVertices, kTestMaxTriangles) {}
 
   void LoadObjFromInputStream(std::istream& input_stream) {
     obj_importer_.ImportGeometryFromInputStream(input_stream);
   }
 
-  Space space_;
+  static constexpr size_t kTestMaxVertices = 1000;
+  static constexpr size_t kTestMaxTriangles = 2000;
+  Mesh mesh_;
   ObjGeometryImporter obj_importer_;
   std::stringstream ss_;
 };
@@ -68,6 +71,44 @@ TEST_F(ObjGeometryImporterTest, TooManyVertexCoordinates) {
   EXPECT_THROW(LoadObjFromInputStream(ss_), MalformedParametersException);
 }
 
+TEST_F(ObjGeometryImporterTest, SharedVerticesAreStoredOnce) {
+  ss_ << "v 0.0 0.0 0.0\n"
+      << "v 1.0 0.0 0.0\n"
+      << "v 1.0 1.0 0.0\n"
+      << "v 0.0 1.0 0.0\n"
+      << "vt 0.0 0.0\n"
+      << "vt 1.0 1.0\n"
+      << "f 1/1 2/1 3/1\n"
+      << "f 1/1 3/1 4/1\n"
+      << "f 1/2 3/1 4/1\n";
+  LoadObjFromInputStream(ss_);
+  EXPECT_EQ(3, mesh_.GetTriangleCount());
+  EXPECT_EQ(5, mesh_.GetVertexCount());
+  EXPECT_EQ(mesh_.GetIndices()(1, 0), mesh_.GetIndices()(2, 1));
+  EXPECT_NE(mesh_.GetIndices()(0, 1), mesh_.GetIndices()(0, 2));
+  EXPECT_EQ(Vector2(1.0, 1.0), mesh_.GetUVCoordinates().col(4));
+}
+
+TEST_F(ObjGeometryImporterTest, ObjectsAndGroupsSplitTheMesh) {
+  ss_ << "v 0.0 0.0 0.0\n"
+      << "v 1.0 0.0 0.0\n"
+      << "v 1.0 1.0 0.0\n"
+      << "v 0.0 1.0 4.0\n"
+      << "o first\n"
+      << "f 1 2 3\n"
+      << "f 1 3 2\n"
+      << "g second\n"
+      << "f 1 3 4\n";
+  LoadObjFromInputStream(ss_);
+  ASSERT_EQ(2, mesh_.GetObjects().size());
+  EXPECT_EQ(2, mesh_.GetObjects()[0].triangle_count);
+  EXPECT_EQ(3, mesh_.GetObjects()[0].vertex_count);
+  EXPECT_EQ(2, mesh_.GetObjects()[1].first_triangle);
+  EXPECT_EQ(0, mesh_.GetObjects()[1].first_vertex);
+  EXPECT_EQ(4, mesh_.GetObjects()[1].vertex_count);
+  EXPECT_FLOAT_EQ(2.0, mesh_.GetObjects()[1].bounding_center[kZ]);
+}
+
 TEST_F(ObjGeometryImporterTest, UnknownCommand) {
   ss_ << "# This invalid OBJ file contains an unsupported command 'xyz'.\n"
       << "\n"
@@ -78,9 +119,9 @@ TEST_F(ObjGeometryImporterTest, UnknownCommand) {
 TEST_F(ObjGeometryImporterTest, MaximumNumberOfVerticesAndTriangles) {
   ss_ << "# This valid OBJ file includes the maximum allowed number of\n"
       << "# vertices and triangles\n\n";
-  for (size_t i = 0; i < kMaxVertices; i++)
+  for (size_t i = 0; i < kTestMaxVertices; i++)
     ss_ << "v 0.0 1.1 2.2\n";
-  for (size_t i = 0; i < kMaxTriangles; i++)
+  for (size_t i = 0; i < kTestMaxTriangles; i++)
     ss_ << "f 1 2 3\n";
   EXPECT_NO_THROW(LoadObjFromInputStream(ss_));
 }
@@ -88,7 +129,7 @@ TEST_F(ObjGeometryImporterTest, MaximumNumberOfVerticesAndTriangles) {
 TEST_F(ObjGeometryImporterTest, MaximumNumberOfVerticesExceeded) {
   ss_ << "# This invalid OBJ file exceeds the maximum allowed number of\n"
       << "# vertices\n\n";
-  for (size_t i = 0; i < kMaxVertices + 1; i++)
+  for (size_t i = 0; i < kTestMaxVertices + 1; i++)
     ss_ << "v 0.0 1.1 2.2\n";
   EXPECT_THROW(LoadObjFromInputStream(ss_), WorldLimitsExceededException);
 }
@@ -100,7 +141,7 @@ TEST_F(ObjGeometryImporterTest, MaximumNumberOfTrianglesExceeded) {
       << "v 0.0 1.1 2.2\n"
       << "v 3.3 4.4 5.5\n"
       << "v 6.6 7.7 8.8\n";
-  for (size_t i = 0; i < kMaxTriangles + 1; i++)
+  for (size_t i = 0; i < kTestMaxTriangles + 1; i++)
     ss_ << "f 1 2 3\n";
   EXPECT_THROW(LoadObjFromInputStream(ss_), WorldLimitsExceededException);
 }
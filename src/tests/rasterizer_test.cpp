@@ -0,0 +1,384 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "geometry/space.hpp"
+#include "ui/rasterizer.hpp"
+#include "ui/ui.hpp"
+#include "utility/job_system.hpp"
+
+// Exposes the depth buffer of a rasterizer derived from ScanlineRasterizer
+template <typename RasterizerType>
+class DepthInspectingRasterizer : public RasterizerType {
+ public:
+  using RasterizerType::RasterizerType;
+
+  float GetDepth(uint16_t x, uint16_t y) noexcept {
+    return this->z_buffer_.GetRow(y)[x];
+  }
+};
+
+// Replaces every texel of the loaded texture by its own coordinates, so that
+// the framebuffer shows which texel each pixel sampled
+class TexelCoordinateRasterizer : public TexturedRasterizer {
+ public:
+  TexelCoordinateRasterizer() {
+    SDL_Surface* surface = texture_.GetSurface();
+    for (int v = 0; v < surface->h; v++) {
+      uint32_t* row = reinterpret_cast<uint32_t*>(
+          static_cast<uint8_t*>(surface->pixels) + v * surface->pitch);
+      for (int u = 0; u < surface->w; u++)
+        row[u] = u << 16 | v;
+    }
+  }
+
+  uint16_t GetTextureWidth() const noexcept { return texture_.GetWidth(); }
+  uint16_t GetTextureHeight() const noexcept { return texture_.GetHeight(); }
+};
+
+// Rasterizes triangles given directly in window coordinates into a headless
+// framebuffer whose size is not a multiple of the tile sizes
+class RasterizerTest : public testing::Test {
+ protected:
+  RasterizerTest() : user_interface_(kWidth, kHeight) {}
+
+  // UV coordinates follow the window position, so that textured triangles
+  // show different texels across the screen
+  void AddTriangle(const Vector3& a, const Vector3& b, const Vector3& c) {
+    AddTriangle({a, b, c}, {Vector2(a[kX] / kWidth, a[kY] / kHeight),
+                            Vector2(b[kX] / kWidth, b[kY] / kHeight),
+                            Vector2(c[kX] / kWidth, c[kY] / kHeight)});
+  }
+
+  void AddTriangle(
+      const std::array<Vector3, kVerticesPerTriangle>& positions,
+      const std::array<Vector2, kVerticesPerTriangle>& uv_coordinates) {
+    std::array<Vertex, kVerticesPerTriangle> vertices;
+    for (size_t k = 0; k < kVerticesPerTriangle; k++)
+      vertices[k] = Vertex(
+          Vector4(positions[k][kX], positions[k][kY], positions[k][kZ], 1),
+          UVCoordinate(uv_coordinates[k]));
+    space_.EnqueueAddTriangle(
+        Triangle(vertices[0], vertices[1], vertices[2],
+                 Direction(positions[0][kX], positions[1][kY], 1)));
+  }
+
+  void RemoveTriangles() {
+    std::vector<size_t> indices(space_.GetTriangleCount());
+    std::iota(indices.begin(), indices.end(), 0);
+    space_.EnqueueRemoveMultipleTriangles(indices);
+    space_.UpdateSpace();
+  }
+
+  void AddRandomTriangles(size_t count) {
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> x(-kWidth / 2, kWidth * 1.5f);
+    std::uniform_real_distribution<float> y(-kHeight / 2, kHeight * 1.5f);
+    std::uniform_real_distribution<float> z(-0.9, 0.9);
+    for (size_t i = 0; i < count; i++)
+      AddTriangle({x(generator), y(generator), z(generator)},
+                  {x(generator), y(generator), z(generator)},
+                  {x(generator), y(generator), z(generator)});
+  }
+
+  std::vector<uint32_t> Rasterize(Rasterizer& rasterizer) {
+    space_.UpdateSpace();
+    rasterizer.RasterizeSpace(space_, user_interface_);
+    uint8_t* pixels;
+    int pitch;
+    user_interface_.StartFrameRasterization(&pixels, &pitch);
+    std::vector<uint32_t> framebuffer;
+    for (uint16_t y = 0; y < kHeight; y++) {
+      const uint32_t* row = reinterpret_cast<uint32_t*>(pixels + y * pitch);
+      framebuffer.insert(framebuffer.end(), row, row + kWidth);
+    }
+    return framebuffer;
+  }
+
+  // Pixels written with a depth other than the cleared one, with that depth
+  template <typename RasterizerType>
+  std::vector<float> RasterizeDepths(RasterizerType& rasterizer) {
+    space_.UpdateSpace();
+    rasterizer.RasterizeSpace(space_, user_interface_);
+    std::vector<float> depths;
+    for (uint16_t y = 0; y < kHeight; y++)
+      for (uint16_t x = 0; x < kWidth; x++)
+        depths.push_back(rasterizer.GetDepth(x, y));
+    return depths;
+  }
+
+  static constexpr uint16_t kWidth = 200;
+  static constexpr float kDepthTolerance = 1.0E-3;
+  static constexpr float kUVTolerance = 1.0E-2;
+  static constexpr uint16_t kHeight = 150;
+  Space space_;
+  BenchmarkInterface user_interface_;
+};
+
+TEST_F(RasterizerTest, TiledMatchesTexturedAcrossTileEdges) {
+  // Straddling the first tile column and row, covering the corner between
+  // four tiles, and reaching into the partial tiles at the right and bottom
+  AddTriangle({60, 10, 0.2}, {70, 10, 0.2}, {65, 40, 0.2});
+  AddTriangle({10, 60, 0.3}, {40, 66, 0.3}, {12, 70, 0.3});
+  AddTriangle({50, 50, -0.5}, {80, 52, 0.1}, {55, 90, 0.4});
+  AddTriangle({120, 100, 0}, {199, 120, 0}, {130, 149, 0.5});
+  // Larger than the screen, with vertices in the guard band
+  AddTriangle({-300, -200, 0.8}, {600, -100, 0.6}, {100, 400, 0.7});
+  AddRandomTriangles(200);
+  TexturedRasterizer textured;
+  std::vector<uint32_t> expected = Rasterize(textured);
+  JobSystem job_system(4);
+  TiledRasterizer tiled(job_system);
+  EXPECT_EQ(expected, Rasterize(tiled));
+}
+
+
+// Each triangle is rasterized on its own, so that the depth differences of
+// the two interpolation schemes cannot change which triangle wins a pixel
+TEST_F(RasterizerTest, EdgeFunctionMatchesScanlineCoverage) {
+  const std::vector<std::array<Vector3, kVerticesPerTriangle>> triangles = {
+      // Vertices on pixel corners, so that edges run through pixel centers
+      {{{10, 10, 0.1}, {60, 10, 0.3}, {10, 60, 0.5}}},
+      {{{100, 30, 0}, {130, 10, -0.4}, {150, 40, 0.6}}},
+      // Flat top and flat bottom
+      {{{20, 80, 0.5}, {70, 80, 0.5}, {45, 120, -0.5}}},
+      {{{45, 80, 0.5}, {20, 120, 0.5}, {70, 120, -0.5}}},
+      // Vertices off screen in the guard band
+      {{{-150, -40, 0.3}, {90, 20, 0.1}, {30, 300, 0.7}}},
+      {{{180, 100, 0.2}, {450, 90, 0.4}, {190, 400, -0.3}}},
+      // Slivers and degenerate triangles
+      {{{150, 100, 0.1}, {152, 100, 0.1}, {190, 149, 0.1}}},
+      {{{10, 140, 0.1}, {100, 141, 0.1}, {190, 142, 0.1}}},
+      {{{30, 20, 0}, {40, 40, 0}, {50, 60, 0}}},
+      {{{30, 130, 0}, {90, 130, 0}, {150, 130, 0}}},
+      {{{77, 77, 0}, {77, 77, 0}, {77, 77, 0}}}};
+  DepthInspectingRasterizer<ScanlineRasterizer> scanline;
+  DepthInspectingRasterizer<EdgeFunctionRasterizer> edge_function;
+  // Scanline depth is interpolated between span ends rounded to whole
+  // pixels, so it may be off by the depth step of about one pixel
+  size_t covered = 0;
+  auto expect_same_pixels = [this, &scanline, &edge_function, &covered] {
+    std::vector<float> expected = RasterizeDepths(scanline);
+    std::vector<float> actual = RasterizeDepths(edge_function);
+    float depth_step = 0;
+    for (size_t i = 0; i + kWidth < expected.size(); i++)
+      for (size_t neighbour : {i + 1, i + kWidth})
+        if (expected[i] != kClearDepth && expected[neighbour] != kClearDepth)
+          depth_step = std::max(
+              depth_step, std::fabs(expected[i] - expected[neighbour]));
+    for (size_t i = 0; i < expected.size(); i++) {
+      ASSERT_EQ(expected[i] == kClearDepth, actual[i] == kClearDepth)
+          << "at " << i % kWidth << ", " << i / kWidth;
+      covered += expected[i] != kClearDepth;
+      ASSERT_NEAR(expected[i], actual[i], 2 * depth_step + kDepthTolerance)
+          << "at " << i % kWidth << ", " << i / kWidth;
+    }
+  };
+  for (size_t i = 0; i < triangles.size(); i++) {
+    SCOPED_TRACE(testing::Message() << "triangle " << i);
+    AddTriangle(triangles[i][0], triangles[i][1], triangles[i][2]);
+    expect_same_pixels();
+    RemoveTriangles();
+  }
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<float> x(-kWidth / 2, kWidth * 1.5f);
+  std::uniform_real_distribution<float> y(-kHeight / 2, kHeight * 1.5f);
+  std::uniform_real_distribution<float> z(-0.9, 0.9);
+  for (size_t i = 0; i < 100; i++) {
+    SCOPED_TRACE(testing::Message() << "random triangle " << i);
+    AddTriangle({x(generator), y(generator), z(generator)},
+                {x(generator), y(generator), z(generator)},
+                {x(generator), y(generator), z(generator)});
+    expect_same_pixels();
+    RemoveTriangles();
+  }
+  EXPECT_GT(covered, kWidth * kHeight);
+}
+
+// Triangles of equal depth that share edges, where the later one wins the
+// pixels both cover, so the framebuffers match only if every span does
+TEST_F(RasterizerTest, EdgeFunctionMatchesScanlineOnSharedEdges) {
+  for (int row = 0; row < 4; row++)
+    for (int column = 0; column < 6; column++) {
+      float x = column * 35 - 20;
+      float y = row * 45 - 15;
+      float skew = (row + column) % 3 * 7;
+      AddTriangle({x, y, 0.5}, {x + 35 + skew, y, 0.5}, {x, y + 45, 0.5});
+      AddTriangle({x + 35 + skew, y, 0.5}, {x + 35, y + 45, 0.5},
+                  {x, y + 45, 0.5});
+    }
+  for (float angle = 0; angle < 2 * kPi; angle += kPi / 5)
+    AddTriangle({100, 75, 0.2},
+                {100 + 60 * std::cos(angle), 75 + 60 * std::sin(angle), 0.2},
+                {100 + 60 * std::cos(angle + kPi / 5),
+                 75 + 60 * std::sin(angle + kPi / 5), 0.2});
+  ScanlineRasterizer scanline;
+  std::vector<uint32_t> expected = Rasterize(scanline);
+  EdgeFunctionRasterizer edge_function;
+  EXPECT_EQ(expected, Rasterize(edge_function));
+}
+
+// A quad receding steeply into the distance, where affine UV interpolation
+// would be off by many texels. Every pixel inside one of its triangles must
+// show the texel of the UVs interpolated with the reciprocal depth.
+TEST_F(RasterizerTest, TexturedInterpolatesUVsInPerspective) {
+  const std::array<Vector3, 4> corners = {
+      Vector3(10, 145, -0.9), Vector3(190, 145, -0.9), Vector3(130, 5, 0.95),
+      Vector3(70, 5, 0.95)};
+  const std::array<Vector2, 4> uv_coordinates = {
+      Vector2(0, 0), Vector2(1, 0), Vector2(1, 1), Vector2(0, 1)};
+  const std::array<std::array<size_t, kVerticesPerTriangle>, 2> triangles = {
+      {{0, 1, 2}, {0, 2, 3}}};
+  for (const auto& t : triangles)
+    AddTriangle({corners[t[0]], corners[t[1]], corners[t[2]]},
+                {uv_coordinates[t[0]], uv_coordinates[t[1]],
+                 uv_coordinates[t[2]]});
+  TexelCoordinateRasterizer textured;
+  std::vector<uint32_t> framebuffer = Rasterize(textured);
+  const float width = textured.GetTextureWidth() - 1;
+  const float height = textured.GetTextureHeight() - 1;
+
+  // The reciprocal of the view-space depth is affine in the NDC depth
+  auto reciprocal_w = [](float z) {
+    return (z - (kFarPlaneDistance + kNearPlaneDistance) /
+                    (kFarPlaneDistance - kNearPlaneDistance)) *
+           (kFarPlaneDistance - kNearPlaneDistance) /
+           (2 * kNearPlaneDistance * kFarPlaneDistance);
+  };
+  size_t checked = 0;
+  float largest_affine_error = 0;
+  for (uint16_t y = 0; y < kHeight; y++)
+    for (uint16_t x = 0; x < kWidth; x++)
+      for (const auto& t : triangles) {
+        const Vector3& a = corners[t[0]];
+        const Vector3& b = corners[t[1]];
+        const Vector3& c = corners[t[2]];
+        float area = (b[kX] - a[kX]) * (c[kY] - a[kY]) -
+                     (c[kX] - a[kX]) * (b[kY] - a[kY]);
+        Vector3 barycentric(
+            ((b[kX] - x) * (c[kY] - y) - (c[kX] - x) * (b[kY] - y)) / area,
+            ((c[kX] - x) * (a[kY] - y) - (a[kX] - x) * (c[kY] - y)) / area,
+            ((a[kX] - x) * (b[kY] - y) - (b[kX] - x) * (a[kY] - y)) / area);
+        if (barycentric.minCoeff() < 0)
+          continue;
+        Vector2 weighted_uv(0, 0);
+        Vector2 affine_uv(0, 0);
+        float weight = 0;
+        for (size_t k = 0; k < kVerticesPerTriangle; k++) {
+          float r = barycentric[k] * reciprocal_w(corners[t[k]][kZ]);
+          weighted_uv += uv_coordinates[t[k]] * r;
+          weight += r;
+          affine_uv += uv_coordinates[t[k]] * barycentric[k];
+        }
+        Vector2 expected = weighted_uv / weight;
+        uint32_t texel = framebuffer[y * kWidth + x];
+        Vector2 actual((texel >> 16) / width, 1 - (texel & 0xffff) / height);
+        EXPECT_NEAR(expected[kU], actual[kU], kUVTolerance + 1 / width)
+            << "at " << x << ", " << y;
+        EXPECT_NEAR(expected[kV], actual[kV], kUVTolerance + 1 / height)
+            << "at " << x << ", " << y;
+        largest_affine_error = std::max(
+            largest_affine_error, (affine_uv - expected).cwiseAbs().maxCoeff());
+        checked++;
+        break;
+      }
+  EXPECT_GT(checked, kWidth * kHeight / 3);
+  EXPECT_GT(largest_affine_error, 10 * kUVTolerance);
+}
+
+// Strongly receding triangles, with the far vertex a few pixels from the
+// near edge. Extrapolating the reciprocal depth to the block boundaries
+// beyond their tips would cross zero, so every texel must still come from
+// within the UV range of the vertices.
+TEST_F(RasterizerTest, TexturedKeepsUVsInRangeOnRecedingTriangles) {
+  const std::array<std::array<Vector3, kVerticesPerTriangle>, 2> triangles = {
+      {{Vector3(150, 20, -0.99), Vector3(150, 130, -0.99),
+        Vector3(110, 75, 0.999)},
+       {Vector3(50, 20, -0.99), Vector3(50, 130, -0.99),
+        Vector3(90, 75, 0.999)}}};
+  const std::array<Vector2, kVerticesPerTriangle> uv_coordinates = {
+      Vector2(0.25, 0.25), Vector2(0.25, 0.75), Vector2(0.75, 0.5)};
+  for (const auto& t : triangles)
+    AddTriangle(t, uv_coordinates);
+  TexelCoordinateRasterizer textured;
+  std::vector<uint32_t> framebuffer = Rasterize(textured);
+  const float width = textured.GetTextureWidth() - 1;
+  const float height = textured.GetTextureHeight() - 1;
+
+  size_t checked = 0;
+  for (uint16_t y = 0; y < kHeight; y++)
+    for (uint16_t x = 0; x < kWidth; x++)
+      for (const auto& t : triangles) {
+        const Vector3& a = t[0];
+        const Vector3& b = t[1];
+        const Vector3& c = t[2];
+        float area = (b[kX] - a[kX]) * (c[kY] - a[kY]) -
+                     (c[kX] - a[kX]) * (b[kY] - a[kY]);
+        Vector3 barycentric(
+            ((b[kX] - x) * (c[kY] - y) - (c[kX] - x) * (b[kY] - y)) / area,
+            ((c[kX] - x) * (a[kY] - y) - (a[kX] - x) * (c[kY] - y)) / area,
+            ((a[kX] - x) * (b[kY] - y) - (b[kX] - x) * (a[kY] - y)) / area);
+        // Pixels on the edges are left to the fill rule
+        if (barycentric.minCoeff() <= 0)
+          continue;
+        uint32_t texel = framebuffer[y * kWidth + x];
+        Vector2 actual((texel >> 16) / width, 1 - (texel & 0xffff) / height);
+        for (UVDimension d : {kU, kV}) {
+          float tolerance = kUVTolerance + 1 / (d == kU ? width : height);
+          EXPECT_GE(actual[d], 0.25 - tolerance) << "at " << x << ", " << y;
+          EXPECT_LE(actual[d], 0.75 + tolerance) << "at " << x << ", " << y;
+        }
+        checked++;
+        break;
+      }
+  EXPECT_GT(checked, 2000);
+}
+
+// A triangle hidden behind a nearer one is rejected by the hierarchical depth
+// buffer, but still counts towards the depth complexity of its pixels
+TEST_F(RasterizerTest, DepthComplexityCountsOccludedLayers) {
+  AddTriangle({10, 10, -0.5}, {190, 10, -0.5}, {100, 140, -0.5});
+  AddTriangle({60, 40, 0.5}, {140, 40, 0.5}, {100, 100, 0.5});
+  OverdrawRasterizer fragment_writes(HeatmapMetric::kFragmentWrites);
+  OverdrawRasterizer depth_tests(HeatmapMetric::kDepthTests);
+  std::vector<uint32_t> writes_heatmap = Rasterize(fragment_writes);
+  std::vector<uint32_t> tests_heatmap = Rasterize(depth_tests);
+  const size_t single_layer = 20 * kWidth + 100;
+  const size_t two_layers = 60 * kWidth + 100;
+  EXPECT_EQ(writes_heatmap[single_layer], writes_heatmap[two_layers]);
+  EXPECT_EQ(writes_heatmap[single_layer], tests_heatmap[single_layer]);
+  EXPECT_NE(tests_heatmap[single_layer], tests_heatmap[two_layers]);
+  EXPECT_GT(depth_tests.GetStatistics().depth_tested,
+            fragment_writes.GetStatistics().depth_tested);
+}
+
+// The depth buffer counts covered pixels as they are written, also through
+// the vector stores of the edge-function kernel and from parallel tiles
+TEST_F(RasterizerTest, CountsCoveredPixelsAsWritten) {
+  AddRandomTriangles(300);
+  JobSystem job_system(4);
+  DepthInspectingRasterizer<ScanlineRasterizer> scanline;
+  DepthInspectingRasterizer<EdgeFunctionRasterizer> edge_function;
+  DepthInspectingRasterizer<TexturedRasterizer> textured;
+  DepthInspectingRasterizer<TiledRasterizer> tiled(job_system);
+  auto expect_covered_pixels = [this](auto& rasterizer) {
+    std::vector<float> depths = RasterizeDepths(rasterizer);
+    size_t covered = std::count_if(depths.begin(), depths.end(),
+                                   [](float z) { return z != kClearDepth; });
+    RasterizerStatistics statistics = rasterizer.GetStatistics();
+    EXPECT_GT(covered, kWidth * kHeight / 2);
+    EXPECT_EQ(covered, statistics.pixels_covered);
+    EXPECT_GE(statistics.depth_passed, statistics.pixels_covered);
+    EXPECT_FLOAT_EQ(static_cast<float>(statistics.depth_passed) / covered,
+                    statistics.overdraw_ratio);
+  };
+  expect_covered_pixels(scanline);
+  expect_covered_pixels(edge_function);
+  expect_covered_pixels(textured);
+  expect_covered_pixels(tiled);
+  // Counted afresh in every frame
+  expect_covered_pixels(tiled);
+}
@@ -1,8 +1,12 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <memory>
+#include <numeric>
+#include <sstream>
 #include <thread>
 
+#include "geometry/clipper.hpp"
 #include "geometry/coordinate.hpp"
 #include "geometry/direction.hpp"
 #include "geometry/line_segment.hpp"
@@ -12,18 +16,23 @@
 #include "geometry/transform.hpp"
 #include "geometry/triangle.hpp"
 #include "geometry/vertex.hpp"
+#include "ui/z_buffer.hpp"
+#include "utility/benchmark.hpp"
+#include "utility/job_system.hpp"
+#include "utility/profiler.hpp"
+#include "utility/resolution_scaler.hpp"
 #include "utility/timer.hpp"
 
 namespace {
-TriangleSharedPointer CreateRandomTriangle() {
+Triangle CreateRandomTriangle() {
   Vertex v1(Vector3::Random().eval());
   Vertex v2(Vector3::Random().eval());
   Vertex v3(Vector3::Random().eval());
-  return std::make_shared<Triangle>(v1, v2, v3);
+  return Triangle(v1, v2, v3);
 }
 
-std::vector<TriangleSharedPointer> CreateRandomTriangleVector(size_t length) {
-  std::vector<TriangleSharedPointer> triangle_array;
+std::vector<Triangle> CreateRandomTriangleVector(size_t length) {
+  std::vector<Triangle> triangle_array;
   for (size_t i = 0; i < length; i++) {
     triangle_array.push_back(CreateRandomTriangle());
   }
@@ -32,10 +41,10 @@ std::vector<TriangleSharedPointer> CreateRandomTriangleVector(size_t length) {
 
 void EnqueAddMultipleTriangles(
     std::vector<size_t> ordered_triangle_indices,
-    std::vector<TriangleSharedPointer>& triangle_ptr_vector,
+    std::vector<Triangle>& triangle_vector,
     Space& space) {
   for (size_t i : ordered_triangle_indices) {
-    space.EnqueueAddTriangle(triangle_ptr_vector.at(i));
+    space.EnqueueAddTriangle(triangle_vector.at(i));
   }
 }
 
@@ -48,15 +57,15 @@ void VerifyTriangleCount(size_t vector_count, Space& space) {
 
 void VerifyTriangleOrder(
     std::vector<size_t> ordered_indices,
-    std::vector<TriangleSharedPointer>& triangle_ptr_vector,
+    std::vector<Triangle>& triangle_vector,
     Space& space) {
   size_t n = 0;
   for (size_t i : ordered_indices) {
     for (size_t k : {0, 1, 2}) {
-      EXPECT_EQ(triangle_ptr_vector[i]->GetVertex(k).GetVector(),
+      EXPECT_EQ(triangle_vector[i].GetVertex(k).GetVector(),
                 space.GetVertices().col(3 * n + k));
     }
-    EXPECT_EQ(triangle_ptr_vector[i]->GetNormal(), space.GetNormals().col(n));
+    EXPECT_EQ(triangle_vector[i].GetNormal(), space.GetNormals().col(n));
     n++;
   }
 }
@@ -97,6 +106,219 @@ TEST(Timer, BasicOperation) {
   EXPECT_GE(2.0, t.GetDuration());
 }
 
+TEST(JobSystem, ParallelForVisitsEveryIndexOnce) {
+  JobSystem job_system(4);
+  std::vector<std::atomic<int>> visits(1000);
+  for (size_t round = 0; round < 3; round++)
+    job_system.ParallelFor(visits.size(),
+                           [&visits](size_t i) { visits[i]++; });
+  for (const std::atomic<int>& count : visits)
+    EXPECT_EQ(3, count);
+}
+
+TEST(JobSystem, SubmittedJobsRunWhileTheCallerContinues) {
+  JobSystem job_system(2);
+  std::atomic<bool> released(false);
+  std::atomic<bool> done(false);
+  JobCounter counter;
+  job_system.Submit(
+      [&released, &done] {
+        while (!released)
+          std::this_thread::yield();
+        done = true;
+      },
+      counter);
+  released = true;
+  job_system.Wait(counter);
+  EXPECT_TRUE(counter.IsDone());
+  EXPECT_TRUE(done);
+}
+
+TEST(JobSystem, NestedParallelForDoesNotDeadlock) {
+  JobSystem job_system(3);
+  std::atomic<int> visits(0);
+  job_system.ParallelFor(8, [&job_system, &visits](size_t) {
+    job_system.ParallelFor(8, [&visits](size_t) { visits++; });
+  });
+  EXPECT_EQ(64, visits);
+}
+
+TEST(JobSystem, RunsJobsBeyondTheQueueCapacity) {
+  JobSystem job_system(2);
+  std::atomic<bool> released(false);
+  std::atomic<size_t> visits(0);
+  JobCounter counter;
+  job_system.Submit(
+      [&released] {
+        while (!released)
+          std::this_thread::yield();
+      },
+      counter);
+  for (size_t i = 0; i < 2 * kJobQueueCapacity; i++)
+    job_system.Submit([&visits] { visits++; }, counter);
+  released = true;
+  job_system.Wait(counter);
+  EXPECT_EQ(2 * kJobQueueCapacity, visits);
+  job_system.ParallelFor(4 * kJobQueueCapacity,
+                         [&visits](size_t) { visits++; });
+  EXPECT_EQ(6 * kJobQueueCapacity, visits);
+}
+
+TEST(TaskGraph, RunsTasksAfterTheirDependencies) {
+  JobSystem job_system(4);
+  TaskGraph graph;
+  std::atomic<int> step(0);
+  std::array<int, 4> finished_at;
+  size_t a = graph.AddTask([&] { finished_at[0] = step++; });
+  size_t b = graph.AddTask([&] { finished_at[1] = step++; }, {a});
+  size_t c = graph.AddTask([&] { finished_at[2] = step++; }, {a});
+  graph.AddTask([&] { finished_at[3] = step++; }, {b, c});
+  for (size_t round = 0; round < 2; round++) {
+    step = 0;
+    graph.Run(job_system);
+    EXPECT_EQ(0, finished_at[0]);
+    EXPECT_LT(finished_at[0], finished_at[1]);
+    EXPECT_LT(finished_at[0], finished_at[2]);
+    EXPECT_EQ(3, finished_at[3]);
+  }
+}
+
+TEST(Benchmark, PercentileUsesNearestRank) {
+  std::vector<float> values = {5, 1, 4, 2, 3};
+  EXPECT_EQ(1, ::GetPercentile(values, 0));
+  EXPECT_EQ(3, ::GetPercentile(values, 50));
+  EXPECT_EQ(5, ::GetPercentile(values, 95));
+  EXPECT_EQ(5, ::GetPercentile(values, 100));
+  EXPECT_EQ(0, ::GetPercentile({}, 50));
+}
+
+TEST(CameraPath, InterpolatesBetweenKeyframes) {
+  std::stringstream ss(
+      "# frame x y z pitch yaw roll\n"
+      "0 0 0 2 0 0 0\n"
+      "\n"
+      "4 4 0 -2 0.4 0.8 0\n");
+  CameraPath path;
+  path.LoadFromInputStream(ss);
+  EXPECT_EQ(5, path.GetFrameCount());
+  Camera camera = path.GetCamera(1);
+  EXPECT_TRUE(camera.GetLocation().GetVector().isApprox(Vector4(1, 0, 1, 1)));
+  EXPECT_FLOAT_EQ(0.1, camera.GetPitch());
+  EXPECT_FLOAT_EQ(0.2, camera.GetYaw());
+  EXPECT_EQ(path.GetCamera(4), path.GetCamera(9));
+}
+
+TEST(CameraPath, RejectsMalformedKeyframes) {
+  CameraPath path;
+  std::stringstream missing("0 0 0 2 0 0\n");
+  EXPECT_THROW(path.LoadFromInputStream(missing), CameraPathException);
+  std::stringstream unordered("0 0 0 2 0 0 0\n0 1 0 2 0 0 0\n");
+  EXPECT_THROW(path.LoadFromInputStream(unordered), CameraPathException);
+  std::stringstream empty("# nothing\n");
+  EXPECT_THROW(path.LoadFromInputStream(empty), CameraPathException);
+}
+
+TEST(Profiler, CollectsNestedZonesPerFrame) {
+  Profiler& profiler = Profiler::GetInstance();
+  profiler.Reset();
+  for (int frame = 0; frame < 2; frame++) {
+    ProfileZone outer("outer");
+    for (int i = 0; i < 3; i++)
+      ProfileZone inner("inner");
+  }
+  profiler.EndFrame();
+  std::vector<ZoneStatistics> statistics = profiler.GetZoneStatistics();
+  ASSERT_EQ(2, statistics.size());
+  EXPECT_EQ("outer", statistics[0].name);
+  EXPECT_EQ(0, statistics[0].depth);
+  EXPECT_FLOAT_EQ(2, statistics[0].calls_per_frame);
+  EXPECT_EQ("inner", statistics[1].name);
+  EXPECT_EQ(1, statistics[1].depth);
+  EXPECT_FLOAT_EQ(6, statistics[1].calls_per_frame);
+  EXPECT_LE(statistics[1].mean_ms, statistics[0].mean_ms);
+  profiler.EndFrame();
+  EXPECT_FLOAT_EQ(1, profiler.GetZoneStatistics()[0].calls_per_frame);
+  profiler.Reset();
+  EXPECT_TRUE(profiler.GetZoneStatistics().empty());
+}
+
+TEST(Profiler, CapturesTraceEventsOfRequestedFrames) {
+  Profiler& profiler = Profiler::GetInstance();
+  profiler.Reset();
+  profiler.StartCapture(1);
+  EXPECT_TRUE(profiler.IsCapturing());
+  { ProfileZone zone("captured"); }
+  profiler.EndFrame();
+  EXPECT_FALSE(profiler.IsCapturing());
+  { ProfileZone zone("missed"); }
+  profiler.EndFrame();
+  std::stringstream ss;
+  profiler.WriteTraceEvents(ss);
+  std::string trace = ss.str();
+  EXPECT_NE(std::string::npos,
+            trace.find("{\"name\": \"captured\", \"ph\": \"X\""));
+  EXPECT_NE(std::string::npos, trace.find("\"name\": \"Frame 0\""));
+  EXPECT_EQ(std::string::npos, trace.find("missed"));
+  EXPECT_EQ(std::string::npos, trace.find("Frame 1"));
+  profiler.Reset();
+}
+
+TEST(ResolutionScaler, SettlesWithinBudgetAndRecovers) {
+  ResolutionScaler scaler(10);
+  auto render_frames = [&scaler](float full_scale_ms, size_t count) {
+    size_t changes = 0;
+    for (size_t i = 0; i < count; i++) {
+      float scale = scaler.GetScale();
+      changes += scaler.AddFrame(full_scale_ms * scale * scale);
+    }
+    return changes;
+  };
+  EXPECT_EQ(1u, render_frames(40, 100));
+  EXPECT_FLOAT_EQ(0.5, scaler.GetScale());
+  EXPECT_EQ(400, scaler.GetScaledSize(800));
+  EXPECT_EQ(kRenderScaleSteps - kRenderScaleSteps / 2,
+            render_frames(2, kRenderScaleSteps * kRenderScaleSettleFrames));
+  EXPECT_FLOAT_EQ(1, scaler.GetScale());
+  render_frames(1000, kRenderScaleSettleFrames);
+  EXPECT_FLOAT_EQ(static_cast<float>(kMinRenderScaleSteps) / kRenderScaleSteps,
+                  scaler.GetScale());
+}
+
+TEST(HierarchicalZBuffer, OccludesOnlyBehindEveryWrittenDepth) {
+  auto z_buffer = std::make_unique<HierarchicalZBuffer>();
+  ScreenRectangle tile = {0, 0, kCoarseDepthTileSize - 1,
+                          kCoarseDepthTileSize - 1};
+  EXPECT_FALSE(z_buffer->IsRectangleOccluded(tile, 0.5));
+  for (uint16_t y = 0; y < kCoarseDepthTileSize; y++)
+    for (uint16_t x = 0; x < kCoarseDepthTileSize; x++)
+      EXPECT_TRUE(z_buffer->CheckAndReplace(0.25, x, y));
+  EXPECT_EQ(kCoarseDepthTileSize * kCoarseDepthTileSize,
+            z_buffer->CountWrittenPixels());
+  EXPECT_TRUE(z_buffer->IsRectangleOccluded(tile, 0.5));
+  EXPECT_FALSE(z_buffer->IsRectangleOccluded(tile, 0.1));
+  ScreenRectangle wider = {0, 0, kCoarseDepthTileSize, 1};
+  EXPECT_FALSE(z_buffer->IsRectangleOccluded(wider, 0.5));
+  uint16_t first_x = 0, last_x = 2 * kCoarseDepthTileSize - 1;
+  EXPECT_TRUE(z_buffer->TrimOccludedSpan(first_x, last_x, 1, 0, 0.5));
+  EXPECT_EQ(kCoarseDepthTileSize, first_x);
+  z_buffer->ResetRectangle(tile);
+  EXPECT_FALSE(z_buffer->IsRectangleOccluded(tile, 0.5));
+}
+
+TEST(HierarchicalZBuffer, PadsRowsOfAnySizeToCacheLines) {
+  auto z_buffer = std::make_unique<HierarchicalZBuffer>(37, 21);
+  for (uint16_t y = 0; y < 21; y++)
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(z_buffer->GetRow(y)) %
+                     kCacheLineSize);
+  EXPECT_TRUE(z_buffer->CheckAndReplace(0.5, 36, 20));
+  EXPECT_FALSE(z_buffer->IsRectangleOccluded({32, 16, 36, 20}, 0.25));
+  EXPECT_EQ(1, z_buffer->CountWrittenPixels());
+  z_buffer->Resize(1920, 1080);
+  EXPECT_EQ(1920, z_buffer->GetWidth());
+  EXPECT_EQ(0, z_buffer->CountWrittenPixels());
+  EXPECT_TRUE(z_buffer->CheckAndReplace(0.5, 1919, 1079));
+}
+
 TEST(Coordinate, ConstructorFloats) {
   Coordinate c(1.1, 2.2, 3.3, 4.4);
   EXPECT_EQ(Vector4(1.1, 2.2, 3.3, 4.4), c.GetVector());
@@ -236,20 +458,37 @@ TEST(Triangle, Normal) {
 
 TEST(Space, AddSingleTriangle) {
   Space space;
-  TriangleSharedPointer t_ptr = ::CreateRandomTriangle();
+  std::vector<Triangle> t = {::CreateRandomTriangle()};
   ::VerifyTriangleCount(0, space);
-  EXPECT_EQ(nullptr, space.GetTriangles()[0]);
-  space.EnqueueAddTriangle(t_ptr);
+  space.EnqueueAddTriangle(t[0]);
   ::VerifyTriangleCount(0, space);
-  EXPECT_EQ(nullptr, space.GetTriangles()[0]);
   space.UpdateSpace();
   ::VerifyTriangleCount(1, space);
-  EXPECT_EQ(t_ptr, space.GetTriangles()[0]);
+  ::VerifyTriangleOrder({0}, t, space);
+}
+
+TEST(Space, UVCoordinatesMoveWithTheirTriangle) {
+  Space space;
+  std::vector<Triangle> t;
+  for (float i : {0, 1, 2}) {
+    UVCoordinate uv(i / 4, i / 8);
+    t.emplace_back(Vertex(Vector4::Random(), uv), Vertex(Vector4::Random(), uv),
+                   Vertex(Vector4::Random(), uv), Direction(0, 0, 1));
+  }
+  ::EnqueAddMultipleTriangles({0, 1, 2}, t, space);
+  space.UpdateSpace();
+  space.EnqueueRemoveTriangle(0);
+  space.UpdateSpace();
+  ::VerifyTriangleOrder({2, 1}, t, space);
+  for (size_t k : {0, 1, 2}) {
+    EXPECT_EQ(Vector2(0.5, 0.25), space.GetUVCoordinates().col(k));
+    EXPECT_EQ(Vector2(0.25, 0.125), space.GetUVCoordinates().col(3 + k));
+  }
 }
 
 TEST(Space, AddMultipleTriangles) {
   Space space;
-  std::vector<TriangleSharedPointer> t = ::CreateRandomTriangleVector(4);
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(4);
   ::EnqueAddMultipleTriangles({0, 1, 2, 3}, t, space);
   space.UpdateSpace();
   ::VerifyTriangleCount(4, space);
@@ -258,7 +497,7 @@ TEST(Space, AddMultipleTriangles) {
 
 TEST(Space, RemoveSingleTriangleFromTop) {
   Space space;
-  std::vector<TriangleSharedPointer> t = ::CreateRandomTriangleVector(3);
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(3);
   ::EnqueAddMultipleTriangles({0, 1, 2}, t, space);
   space.UpdateSpace();
   space.EnqueueRemoveTriangle(0);
@@ -269,7 +508,7 @@ TEST(Space, RemoveSingleTriangleFromTop) {
 
 TEST(Space, RemoveSingleTriangleFromMiddle) {
   Space space;
-  std::vector<TriangleSharedPointer> t = ::CreateRandomTriangleVector(3);
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(3);
   ::EnqueAddMultipleTriangles({0, 1, 2}, t, space);
   space.UpdateSpace();
   space.EnqueueRemoveTriangle(1);
@@ -280,7 +519,7 @@ TEST(Space, RemoveSingleTriangleFromMiddle) {
 
 TEST(Space, RemoveSingleTriangleFromBottom) {
   Space space;
-  std::vector<TriangleSharedPointer> t = ::CreateRandomTriangleVector(3);
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(3);
   ::EnqueAddMultipleTriangles({0, 1, 2}, t, space);
   space.UpdateSpace();
   space.EnqueueRemoveTriangle(2);
@@ -291,7 +530,7 @@ TEST(Space, RemoveSingleTriangleFromBottom) {
 
 TEST(Space, RemoveMultipleTriangles) {
   Space space;
-  std::vector<TriangleSharedPointer> t = ::CreateRandomTriangleVector(8);
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(8);
   ::EnqueAddMultipleTriangles({0, 1, 2, 3, 4, 5, 6, 7}, t, space);
   space.UpdateSpace();
   space.EnqueueRemoveTriangle(1);
@@ -303,9 +542,21 @@ TEST(Space, RemoveMultipleTriangles) {
   ::VerifyTriangleOrder({0, 7, 6, 3}, t, space);
 }
 
+TEST(Space, RemoveTrianglesInOneBatch) {
+  Space space;
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(10);
+  ::EnqueAddMultipleTriangles({0, 1, 2, 3, 4, 5, 6, 7}, t, space);
+  space.UpdateSpace();
+  space.EnqueueRemoveMultipleTriangles({6, 0, 2, 4, 7});
+  ::EnqueAddMultipleTriangles({8, 9}, t, space);
+  space.UpdateSpace();
+  ::VerifyTriangleCount(5, space);
+  ::VerifyTriangleOrder({9, 1, 8, 3, 5}, t, space);
+}
+
 TEST(Space, AddAndRemoveEqualAmountOfTriangles) {
   Space space;
-  std::vector<TriangleSharedPointer> t = ::CreateRandomTriangleVector(6);
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(6);
   ::EnqueAddMultipleTriangles({0, 1, 2}, t, space);
   space.UpdateSpace();
   space.EnqueueRemoveTriangle(0);
@@ -318,7 +569,7 @@ TEST(Space, AddAndRemoveEqualAmountOfTriangles) {
 
 TEST(Space, AddMoreThanRemoveTriangles) {
   Space space;
-  std::vector<TriangleSharedPointer> t = ::CreateRandomTriangleVector(10);
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(10);
   ::EnqueAddMultipleTriangles({0, 1, 2, 3, 4, 5}, t, space);
   space.UpdateSpace();
   space.EnqueueRemoveTriangle(2);
@@ -331,7 +582,7 @@ TEST(Space, AddMoreThanRemoveTriangles) {
 
 TEST(Space, RemoveMoreThanAddTriangles) {
   Space space;
-  std::vector<TriangleSharedPointer> t = ::CreateRandomTriangleVector(8);
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(8);
   ::EnqueAddMultipleTriangles({0, 1, 2, 3, 4, 5}, t, space);
   space.UpdateSpace();
   space.EnqueueRemoveTriangle(1);
@@ -346,7 +597,7 @@ TEST(Space, RemoveMoreThanAddTriangles) {
 
 TEST(Space, RemoveAllButOneTriangles) {
   Space space;
-  std::vector<TriangleSharedPointer> t = ::CreateRandomTriangleVector(8);
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(8);
   ::EnqueAddMultipleTriangles({0, 1, 2, 3, 4, 5, 6, 7}, t, space);
   space.UpdateSpace();
   space.EnqueueRemoveTriangle(0);
@@ -361,10 +612,24 @@ TEST(Space, RemoveAllButOneTriangles) {
   ::VerifyTriangleOrder({7}, t, space);
 }
 
+TEST(Space, GrowsWithItsTriangles) {
+  Space space;
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(25000);
+  space.EnqueueAddMultipleTriangles(
+      std::vector<Triangle>(t.begin(), t.begin() + 2));
+  space.UpdateSpace();
+  space.EnqueueAddMultipleTriangles(
+      std::vector<Triangle>(t.begin() + 2, t.end()));
+  space.UpdateSpace();
+  space.EnqueueRemoveTriangle(0);
+  space.UpdateSpace();
+  ::VerifyTriangleCount(t.size() - 1, space);
+  ::VerifyTriangleOrder({t.size() - 1, 1, 2}, t, space);
+}
+
 TEST(Space, Dehomogenize) {
   Space space;
-  TriangleSharedPointer tr = ::CreateRandomTriangle();
-  space.EnqueueAddTriangle(tr);
+  space.EnqueueAddTriangle(::CreateRandomTriangle());
   space.UpdateSpace();
   Matrix4 random_transform = Matrix4::Random();
   space.TransformVertices(random_transform);
@@ -382,7 +647,7 @@ TEST(Space, Dehomogenize) {
 TEST(Space, TransformVerticesAndNormals) {
   Space space;
   Matrix4 random_transform = Matrix4::Random();
-  std::vector<TriangleSharedPointer> t = ::CreateRandomTriangleVector(8);
+  std::vector<Triangle> t = ::CreateRandomTriangleVector(8);
   ::EnqueAddMultipleTriangles({0, 1, 2, 3, 4, 5, 6, 7}, t, space);
   space.UpdateSpace();
   VertexMatrix pre_vertices = space.GetVertices();
@@ -524,53 +789,114 @@ TEST(PespectiveProjection, ConstructorArguments) {
 
 // #TODO: check normals after clipping
 
+TEST(HomogeneousClipper, OutcodeFlagsPlanesThatAreCrossed) {
+  EXPECT_EQ(0, HomogeneousClipper::GetOutcode({0.5, -0.5, 1, 1}));
+  EXPECT_EQ(0b000010, HomogeneousClipper::GetOutcode({2, 0, 0, 1}));
+  EXPECT_EQ(0b100100, HomogeneousClipper::GetOutcode({0, -2, 2, 1}));
+  EXPECT_EQ(0b0010000010, HomogeneousClipper::GetOutcode({5, 0, 0, 1}));
+}
+
 class HomogeneousClippingTest : public testing::Test {
  protected:
-  HomogeneousClippingTest()
-      : v1_(-2.0, 0.5, 1.5),
-        v2_(2.0, 0.5, 1.5),
-        v3_(-2.0, -0.5, 1.5),
-        tr_(std::make_shared<Triangle>(v1_, v2_, v3_)) {
-    space_.EnqueueAddTriangle(tr_);
-    space_.UpdateSpace();
+  void AssembleTriangle(const Triangle& triangle,
+                        ClipMode clip_mode = ClipMode::kViewVolume) {
+    mesh_.EnqueueAddTriangle(triangle);
+    mesh_.UpdateMesh();
+    space_.AssembleTriangles(mesh_, mesh_.GetVertices(), {0}, clip_mode);
   }
   void ExpectTriangle(const Triangle& expected_triangle,
                       const Triangle& actual_triangle) {
-    for (size_t i : {0, 1, 2})
-      EXPECT_EQ(expected_triangle.GetVertex(i), actual_triangle.GetVertex(i));
+    for (size_t i : {0, 1, 2}) {
+      const Vertex& expected = expected_triangle.GetVertex(i);
+      const Vertex& actual = actual_triangle.GetVertex(i);
+      EXPECT_TRUE(expected.GetVector().isApprox(actual.GetVector()));
+      EXPECT_TRUE(expected.GetUVCoordinate().GetVector().isApprox(
+          actual.GetUVCoordinate().GetVector()));
+    }
   }
+  Mesh mesh_;
   Space space_;
-  Vertex v1_;
-  Vertex v2_;
-  Vertex v3_;
-  TriangleSharedPointer tr_;
 };
 
 TEST_F(HomogeneousClippingTest, TriangleIsInside) {
-  space_.ClipAllTriangles(Axis::kY, AxisDirection::kPositive);
+  Triangle tr({-0.5, 0.5, 0.5}, {0.5, 0.5, 0.5}, {-0.5, -0.5, 0.5});
+  AssembleTriangle(tr);
   ::VerifyTriangleCount(1, space_);
-  EXPECT_EQ(tr_, space_.GetTriangles()[0]);
+  ExpectTriangle(tr, space_.GetTriangle(0));
 }
 
 TEST_F(HomogeneousClippingTest, TriangleIsOutside) {
-  space_.ClipAllTriangles(Axis::kZ, AxisDirection::kPositive);
+  AssembleTriangle({{-2.0, 0.5, 1.5}, {2.0, 0.5, 1.5}, {-2.0, -0.5, 1.5}});
   ::VerifyTriangleCount(0, space_);
 }
 
 TEST_F(HomogeneousClippingTest, TriangleIsClippedIntoOne) {
-  space_.ClipAllTriangles(Axis::kX, AxisDirection::kNegative);
+  AssembleTriangle({{0.5, 0.0, 0.5}, {3.0, 0.0, 0.5}, {3.0, 0.5, 0.5}});
   ::VerifyTriangleCount(1, space_);
-  Triangle tr({2.0, 0.5, 1.5}, {-1.0, -0.25, 1.5}, {-1.0, 0.5, 1.5});
-  ExpectTriangle(tr, *space_.GetTriangles()[0]);
+  Triangle tr({1.0, 0.1, 0.5}, {0.5, 0.0, 0.5}, {1.0, 0.0, 0.5});
+  ExpectTriangle(tr, space_.GetTriangle(0));
 }
 
 TEST_F(HomogeneousClippingTest, TriangleIsClippedIntoTwo) {
-  space_.ClipAllTriangles(Axis::kX, AxisDirection::kPositive);
+  AssembleTriangle({Vertex({0.0, 0.0, 0.5, 1.0}, {0.0, 0.0}),
+                    Vertex({2.0, 0.0, 0.5, 1.0}, {1.0, 0.0}),
+                    Vertex({0.0, 1.0, 0.5, 1.0}, {0.0, 1.0})});
   ::VerifyTriangleCount(2, space_);
-  Triangle tr_1({1.0, 0.25, 1.5}, {-2.0, -0.5, 1.5}, {1.0, 0.5, 1.5});
-  Triangle tr_2({1.0, 0.5, 1.5}, {-2.0, -0.5, 1.5}, {-2.0, 0.5, 1.5});
-  ExpectTriangle(tr_1, *space_.GetTriangles()[0]);
-  ExpectTriangle(tr_2, *space_.GetTriangles()[1]);
+  Vertex a({0.0, 0.0, 0.5, 1.0}, {0.0, 0.0});
+  Vertex ab({1.0, 0.0, 0.5, 1.0}, {0.5, 0.0});
+  Vertex bc({1.0, 0.5, 0.5, 1.0}, {0.5, 0.5});
+  Vertex c({0.0, 1.0, 0.5, 1.0}, {0.0, 1.0});
+  ExpectTriangle({a, ab, bc}, space_.GetTriangle(0));
+  ExpectTriangle({a, bc, c}, space_.GetTriangle(1));
+}
+
+TEST_F(HomogeneousClippingTest, TriangleIsClippedByTwoPlanes) {
+  AssembleTriangle({{-2.0, 0.5, 0.5}, {2.0, 0.5, 0.5}, {-2.0, -0.5, 0.5}});
+  ::VerifyTriangleCount(2, space_);
+  for (size_t c = 0; c < kVerticesPerTriangle * 2; c++)
+    EXPECT_EQ(0, HomogeneousClipper::GetOutcode(space_.GetVertices().col(c)));
+}
+
+TEST_F(HomogeneousClippingTest, GuardBandKeepsTriangleCrossingViewport) {
+  Triangle tr({-2.0, 0.5, 0.5}, {2.0, 0.5, 0.5}, {-2.0, -0.5, 0.5});
+  AssembleTriangle(tr, ClipMode::kGuardBand);
+  ::VerifyTriangleCount(1, space_);
+  ExpectTriangle(tr, space_.GetTriangle(0));
+}
+
+TEST_F(HomogeneousClippingTest, GuardBandClipsTriangleBeyondIt) {
+  AssembleTriangle({{0.5, 0.0, 0.5}, {6.0, 0.0, 0.5}, {6.0, 0.5, 0.5}},
+                   ClipMode::kGuardBand);
+  ::VerifyTriangleCount(1, space_);
+  Triangle tr({4.0, 0.3181818, 0.5}, {0.5, 0.0, 0.5}, {4.0, 0.0, 0.5});
+  ExpectTriangle(tr, space_.GetTriangle(0));
+}
+
+TEST_F(HomogeneousClippingTest, ParallelAssemblyKeepsTriangleOrder) {
+  size_t triangle_count = kAssemblyChunkSize * 3 + 7;
+  for (size_t i = 0; i < triangle_count; i++) {
+    float x = -3.0f + 6.0f * i / triangle_count;
+    mesh_.EnqueueAddTriangle(
+        {{x, 0, 0.5}, {x + 0.75f, 0, 0.5}, {x + 0.75f, 0.5, 0.5}});
+  }
+  mesh_.UpdateMesh();
+  std::vector<uint32_t> triangle_indices(triangle_count);
+  std::iota(triangle_indices.begin(), triangle_indices.end(), 0);
+  JobSystem serial_jobs(1), parallel_jobs(4);
+  Space parallel_space;
+  space_.SetJobSystem(serial_jobs);
+  parallel_space.SetJobSystem(parallel_jobs);
+  space_.AssembleTriangles(mesh_, mesh_.GetVertices(), triangle_indices);
+  parallel_space.AssembleTriangles(mesh_, mesh_.GetVertices(),
+                                   triangle_indices);
+  const PipelineStatistics& statistics = parallel_space.GetAssemblyStatistics();
+  EXPECT_LT(0, statistics.trivially_rejected);
+  EXPECT_LT(0, statistics.clipped);
+  ASSERT_EQ(space_.GetTriangleCount(), parallel_space.GetTriangleCount());
+  EXPECT_EQ(space_.GetVertices(), parallel_space.GetVertices());
+  EXPECT_EQ(space_.GetUVCoordinates(), parallel_space.GetUVCoordinates());
+  EXPECT_EQ(space_.GetAssemblyStatistics().produced_by_clipping,
+            statistics.produced_by_clipping);
 }
 
 TEST(ViewportTransform, ConstructorArguments) {
@@ -719,13 +1045,13 @@ class TransformPipelineTest : public testing ::Test {
         perspective_(1, 10, -1, 1, 1, -1),
         viewport_(800, 800, 0, 0),
         pipeline_(camera_, perspective_, viewport_) {
-    world_space_.EnqueueAddTriangle(std::make_shared<Triangle>(v1_, v2_, v3_));
-    world_space_.UpdateSpace();
+    world_mesh_.EnqueueAddTriangle(Triangle(v1_, v2_, v3_));
+    world_mesh_.UpdateMesh();
   }
   void SetAndUpdateCameraLocation(const Point& location) {
     camera_.GetCamera().SetLocation(location);
     camera_.UpdateTransform();
-    pipeline_.RunPipeline(world_space_);
+    pipeline_.RunPipeline(world_mesh_);
   }
   void ExpectFloorRoundedVertices(const Triangle& expected_triangle,
                                   size_t triangle_index) {
@@ -739,7 +1065,7 @@ class TransformPipelineTest : public testing ::Test {
         EXPECT_EQ(lhs, rhs);
       }
   }
-  Space world_space_;
+  Mesh world_mesh_;
   Vertex v1_, v2_, v3_;
   CameraTransform camera_;
   PerspectiveProjection perspective_;
@@ -764,8 +1090,8 @@ TEST_F(TransformPipelineTest, SingleFullyClippedTriangle) {
 TEST_F(TransformPipelineTest, SingleTriangleClippedIntoOne) {
   SetAndUpdateCameraLocation({3, 2, 3});
   EXPECT_EQ(1, pipeline_.GetOutputSpace().GetTriangleCount());
-  Triangle tr({200, 599, expected_z_}, {400, 799, expected_z_},
-              {200, 799, expected_z_});
+  Triangle tr({400, 799, expected_z_}, {200, 799, expected_z_},
+              {200, 599, expected_z_});
   ExpectFloorRoundedVertices(tr, 0);
 }
 
@@ -773,9 +1099,133 @@ TEST_F(TransformPipelineTest, SingleTriangleClippedIntoTwo) {
   SetAndUpdateCameraLocation({3, 2, -1});
   EXPECT_EQ(2, pipeline_.GetOutputSpace().GetTriangleCount());
   Triangle tr_1({400, 0, expected_z_}, {599, 200, expected_z_},
-                {200, 0, expected_z_});
-  Triangle tr_2({200, 0, expected_z_}, {599, 200, expected_z_},
                 {200, 200, expected_z_});
+  Triangle tr_2({400, 0, expected_z_}, {200, 200, expected_z_},
+                {200, 0, expected_z_});
   ExpectFloorRoundedVertices(tr_1, 0);
   ExpectFloorRoundedVertices(tr_2, 1);
 }
+
+TEST_F(TransformPipelineTest, VertexKernelMatchesSeparatePasses) {
+  for (const Point& location : {Point(3, 2, 1), Point(3, 2, -1)}) {
+    SetAndUpdateCameraLocation(location);
+    Space expected;
+    expected.AssembleTriangles(
+        world_mesh_,
+        perspective_.GetMatrix() * camera_.GetMatrix() *
+            world_mesh_.GetVertices(),
+        {0});
+    expected.Dehomogenize();
+    expected.TransformVertices(viewport_.GetMatrix());
+    const Space& actual = pipeline_.GetOutputSpace();
+    ASSERT_EQ(expected.GetTriangleCount(), actual.GetTriangleCount());
+    EXPECT_TRUE(expected.GetVertices().isApprox(actual.GetVertices()));
+  }
+}
+
+TEST_F(TransformPipelineTest, PreparedOutputIsHiddenUntilSwapped) {
+  SetAndUpdateCameraLocation({3, 2, -1});
+  camera_.GetCamera().SetLocation(Point(-3, 2, 1));
+  camera_.UpdateTransform();
+  pipeline_.PrepareOutput(world_mesh_);
+  EXPECT_EQ(2, pipeline_.GetOutputSpace().GetTriangleCount());
+  EXPECT_EQ(1, pipeline_.GetStatistics().clipped);
+  pipeline_.SwapOutputs();
+  EXPECT_EQ(0, pipeline_.GetOutputSpace().GetTriangleCount());
+  EXPECT_EQ(1, pipeline_.GetStatistics().frustum_culled);
+}
+
+TEST_F(TransformPipelineTest, StatisticsCountClippingAndRejection) {
+  SetAndUpdateCameraLocation({3, 2, -1});
+  PipelineStatistics statistics = pipeline_.GetStatistics();
+  EXPECT_EQ(1, statistics.input_triangles);
+  EXPECT_EQ(0, statistics.back_face_culled);
+  EXPECT_EQ(0, statistics.trivially_rejected);
+  EXPECT_EQ(1, statistics.clipped);
+  EXPECT_EQ(2, statistics.produced_by_clipping);
+  SetAndUpdateCameraLocation({-3, 2, 1});
+  statistics = pipeline_.GetStatistics();
+  EXPECT_EQ(1, statistics.frustum_culled);
+  EXPECT_EQ(0, statistics.trivially_rejected);
+  EXPECT_EQ(0, statistics.clipped);
+  EXPECT_EQ(0, statistics.produced_by_clipping);
+  SetAndUpdateCameraLocation({3, -2, 1});
+  EXPECT_EQ(1, pipeline_.GetStatistics().frustum_culled);
+  EXPECT_EQ(0, pipeline_.GetStatistics().back_face_culled);
+}
+
+TEST_F(TransformPipelineTest, BackFaceCullingCoversPartialBlocks) {
+  for (size_t i = 0; i < 20; i++)
+    world_mesh_.EnqueueAddTriangle(i % 3 ? Triangle(v1_, v3_, v2_)
+                                         : Triangle(v1_, v2_, v3_));
+  world_mesh_.UpdateMesh();
+  SetAndUpdateCameraLocation({3, 2, 1});
+  EXPECT_EQ(13, pipeline_.GetStatistics().back_face_culled);
+  EXPECT_EQ(8, pipeline_.GetOutputSpace().GetTriangleCount());
+}
+
+TEST_F(TransformPipelineTest, ObjectsOutsideTheViewVolumeAreCulledWhole) {
+  world_mesh_.BeginObject();
+  for (float x : {-6, -5})
+    world_mesh_.EnqueueAddTriangle(Triangle({x, 0, 0}, {x + 2, 0, 0},
+                                            {x + 2, 0, 2}));
+  world_mesh_.UpdateMesh();
+  ASSERT_EQ(2, world_mesh_.GetObjects().size());
+  const MeshObject& object = world_mesh_.GetObjects()[1];
+  EXPECT_EQ(1, object.first_triangle);
+  EXPECT_EQ(2, object.triangle_count);
+  EXPECT_EQ(3, object.first_vertex);
+  EXPECT_EQ(6, object.vertex_count);
+  EXPECT_TRUE(object.bounding_center.isApprox(Vector3(-4.5, 0, 1)));
+  EXPECT_FLOAT_EQ(std::sqrt(3.25f), object.bounding_radius);
+  SetAndUpdateCameraLocation({3, 2, 1});
+  EXPECT_EQ(2, pipeline_.GetStatistics().frustum_culled);
+  EXPECT_EQ(0, pipeline_.GetStatistics().back_face_culled);
+  ASSERT_EQ(1, pipeline_.GetOutputSpace().GetTriangleCount());
+  ExpectFloorRoundedVertices(pipeline_.GetOutputSpace().GetTriangle(0), 0);
+  SetAndUpdateCameraLocation({-4, 2, 1});
+  EXPECT_EQ(1, pipeline_.GetStatistics().frustum_culled);
+  EXPECT_EQ(2, pipeline_.GetOutputSpace().GetTriangleCount());
+}
+
+TEST_F(TransformPipelineTest, ObjectsInsideTheViewVolumeSkipClipping) {
+  world_mesh_.BeginObject();
+  world_mesh_.EnqueueAddTriangle(
+      Triangle({3, 0, 1}, {3.001, 0, 1}, {3.001, 0, 1.001}));
+  world_mesh_.EnqueueAddTriangle(
+      Triangle({2.9, 0, 0.9}, {3.1, 0, 0.9}, {3.1, 0, 1.1}));
+  world_mesh_.BeginObject();
+  world_mesh_.EnqueueAddTriangle(Triangle({2, 0, 0}, {7, 0, 0}, {7, 0, 5}));
+  world_mesh_.UpdateMesh();
+  ASSERT_EQ(3, world_mesh_.GetObjects().size());
+  SetAndUpdateCameraLocation({3, 2, 1});
+  EXPECT_EQ(0, pipeline_.GetStatistics().frustum_culled);
+  EXPECT_EQ(1, pipeline_.GetStatistics().clipped);
+  size_t produced = pipeline_.GetStatistics().produced_by_clipping;
+  ASSERT_EQ(3 + produced, pipeline_.GetOutputSpace().GetTriangleCount());
+  Triangle inside({419, 419, expected_z_}, {380, 419, expected_z_},
+                  {380, 380, expected_z_});
+  ExpectFloorRoundedVertices(inside, 2);
+  // The inside flags follow the triangles that screen-space culling keeps
+  pipeline_.SetScreenSpaceCulling(true);
+  pipeline_.RunPipeline(world_mesh_);
+  EXPECT_EQ(1, pipeline_.GetStatistics().screen_culled);
+  EXPECT_EQ(1, pipeline_.GetStatistics().clipped);
+  EXPECT_EQ(produced, pipeline_.GetStatistics().produced_by_clipping);
+  ASSERT_EQ(2 + produced, pipeline_.GetOutputSpace().GetTriangleCount());
+  ExpectFloorRoundedVertices(inside, 1);
+}
+
+TEST_F(TransformPipelineTest, ScreenSpaceCullingDropsSubpixelTriangles) {
+  world_mesh_.EnqueueAddTriangle(
+      Triangle({2, 0, 0}, {2.001, 0, 0}, {2.001, 0, 0.001}));
+  world_mesh_.UpdateMesh();
+  SetAndUpdateCameraLocation({3, 2, 1});
+  EXPECT_EQ(0, pipeline_.GetStatistics().screen_culled);
+  EXPECT_EQ(2, pipeline_.GetOutputSpace().GetTriangleCount());
+  pipeline_.SetScreenSpaceCulling(true);
+  pipeline_.RunPipeline(world_mesh_);
+  EXPECT_EQ(1, pipeline_.GetStatistics().screen_culled);
+  ASSERT_EQ(1, pipeline_.GetOutputSpace().GetTriangleCount());
+  ExpectFloorRoundedVertices(pipeline_.GetOutputSpace().GetTriangle(0), 0);
+}
@@ -1,7 +1,12 @@
 #include <SDL2/SDL.h>
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include "ui/rasterizer.hpp"
+#include "utility/profiler.hpp"
+#include "utility/simd.hpp"
 
 namespace {
 size_t GetBoundaryVertexIndexByDimension(size_t a_index,
@@ -9,7 +14,7 @@ size_t GetBoundaryVertexIndexByDimension(size_t a_index,
                                          size_t c_index,
                                          enum Axis axis,
                                          BoundaryType boundary_type,
-                                         const VertexMatrix& vertices) {
+                                         const VertexMatrixView& vertices) {
   float a = vertices(axis, a_index);
   float b = vertices(axis, b_index);
   float c = vertices(axis, c_index);
@@ -27,8 +32,8 @@ size_t GetBoundaryVertexIndexByDimension(size_t a_index,
 }
 
 void SwapTopAndLow(PixelCoordinates& pc, OrderedVertexIndices& vi) noexcept {
-  uint16_t tmp_x = pc.low_x;
-  uint16_t tmp_y = pc.low_y;
+  int16_t tmp_x = pc.low_x;
+  int16_t tmp_y = pc.low_y;
   float tmp_z = pc.low_z;
   float tmp_i = vi.low;
   pc.low_x = pc.top_x;
@@ -41,14 +46,24 @@ void SwapTopAndLow(PixelCoordinates& pc, OrderedVertexIndices& vi) noexcept {
   vi.top = tmp_i;
 }
 
+// Integer division rounded towards negative infinity, as truncation would
+// move span ends left of the viewport one pixel to the right
+int FloorDivide(int numerator, int denominator) noexcept {
+  int quotient = numerator / denominator;
+  if (numerator % denominator != 0 && (numerator < 0) != (denominator < 0))
+    quotient--;
+  return quotient;
+}
+
 void CalculateXScanlineBoundaries(ScanlineParameters& sp,
                                   const PixelCoordinates pc) noexcept {
-  sp.scan_x_left = (sp.scan_y * pc.low_x - pc.top_x * sp.scan_y -
-                    pc.top_y * pc.low_x + pc.top_x * pc.low_y) /
-                   (pc.low_y - pc.top_y);
-  sp.scan_x_right = (sp.scan_y * pc.mid_x - pc.top_x * sp.scan_y -
-                     pc.top_y * pc.mid_x + pc.top_x * pc.mid_y) /
-                    (pc.mid_y - pc.top_y);
+  sp.scan_x_left = ::FloorDivide(sp.scan_y * pc.low_x - pc.top_x * sp.scan_y -
+                                     pc.top_y * pc.low_x + pc.top_x * pc.low_y,
+                                 pc.low_y - pc.top_y);
+  sp.scan_x_right =
+      ::FloorDivide(sp.scan_y * pc.mid_x - pc.top_x * sp.scan_y -
+                        pc.top_y * pc.mid_x + pc.top_x * pc.mid_y,
+                    pc.mid_y - pc.top_y);
   sp.scan_x_increment = sp.scan_x_right < sp.scan_x_left ? -1 : 1;
 }
 
@@ -76,89 +91,252 @@ void SetScanlineIncrementY(ScanlineParameters& sp,
   sp.scan_y_increment = triangle_half == TriangleHalf::kLower ? -1 : 1;
 }
 
-float TrueZ(float reciprocal_z) noexcept {
+// Clamps an inclusive scan range from first to last, walked in the direction
+// of the increment, into [min, max]. Returns false if the clamped range is
+// empty.
+bool ClampScanRange(int first,
+                    int last,
+                    int8_t increment,
+                    uint16_t min,
+                    uint16_t max,
+                    uint16_t& clamped_first,
+                    uint16_t& clamped_last) noexcept {
+  if (increment > 0) {
+    first = std::max<int>(first, min);
+    last = std::min<int>(last, max);
+    if (first > last)
+      return false;
+  } else {
+    first = std::min<int>(first, max);
+    last = std::max<int>(last, min);
+    if (first < last)
+      return false;
+  }
+  clamped_first = first;
+  clamped_last = last;
+  return true;
+}
+
+// Screen coordinates are floored rather than truncated, which only differs
+// for vertices left of or above the viewport
+int16_t GetPixelCoordinate(float screen_coordinate) noexcept {
+  return static_cast<int16_t>(std::floor(screen_coordinate));
+}
+
+uint8_t GetTriangleColorValue(const Vector4& normal) noexcept {
+  Direction light_direction = {1, 2, 3};
+  float brightness =
+      light_direction.GetVector().normalized().dot(normal.normalized());
+  brightness = (brightness + 1) / 2;
+  return brightness * 0xff;
+}
+
+// Edge from (from_x, from_y) to (to_x, to_y) with from_y <= to_y. Scanline
+// spans run from floor(x_left) to floor(x_right) inclusive, which for integer
+// pixels means x + 1 > x_left and x <= x_right. Both are expressed as F >= 0;
+// horizontal edges never constrain and are mapped to a constant F = 1.
+EdgeFunction GetEdgeFunction(int from_x,
+                             int from_y,
+                             int to_x,
+                             int to_y,
+                             bool left_edge) noexcept {
+  int dx = to_x - from_x;
+  int dy = to_y - from_y;
+  assert(dy >= 0);
+  if (dy == 0)
+    return {0, 0, 1};
+  // E(x, y) = dy * (x - from_x) - dx * (y - from_y) is positive to the right
+  float a = dy;
+  float b = -dx;
+  float c = -(static_cast<float>(dy) * from_x - static_cast<float>(dx) * from_y);
+  if (left_edge)
+    return {a, b, c + a - 1};  // E(x + 1, y) > 0 for integer-valued E
+  return {-a, -b, -c};
+}
+
+// Black for zero, then blue through green and red to white at
+// kHeatmapLevels, in ARGB
+uint32_t GetHeatmapColor(uint16_t count) noexcept {
+  static constexpr std::array<uint32_t, kHeatmapLevels + 1> kColors = {
+      0xff000000, 0xff0000ff, 0xff0080ff, 0xff00ff80, 0xff80ff00,
+      0xffffff00, 0xffff8000, 0xffff0000, 0xffffffff};
+  return kColors[std::min<uint16_t>(count, kHeatmapLevels)];
+}
+
+float GetNearestDepth(const PixelCoordinates& pc) noexcept {
+  return std::min({pc.top_z, pc.mid_z, pc.low_z});
+}
+
+// Reciprocal of the view-space depth, which is affine in the NDC depth
+float ReciprocalTrueZ(float ndc_z) noexcept {
   constexpr float A = 2 * kNearPlaneDistance * kFarPlaneDistance /
                       (kFarPlaneDistance - kNearPlaneDistance);
   constexpr float B = (kFarPlaneDistance + kNearPlaneDistance) /
                       (kFarPlaneDistance - kNearPlaneDistance);
-  return A / (reciprocal_z - B);
+  return (ndc_z - B) / A;
 }
 }  // namespace
 
-void WireframeRasterizer::RasterizeGameState(
-    const GameState& game_state,
+void Rasterizer::RasterizeGameState(const GameState& game_state,
+                                    UserInterface& user_interface) noexcept {
+  RasterizeSpace(game_state.GetOutputSpace(), user_interface);
+}
+
+// Rasterizers without a depth buffer have no fragment counters
+RasterizerStatistics Rasterizer::GetStatistics() const noexcept {
+  return {};
+}
+
+void WireframeRasterizer::RasterizeSpace(
+    const Space& space,
     UserInterface& user_interface) noexcept {
-  const Space& space = game_state.GetOutputSpace();
+  PROFILE_ZONE("WireframeRasterizer");
   user_interface.ClearWithBackgroundColor();
   for (size_t t = 0; t < space.GetTriangleCount(); t++) {
     for (size_t a : {0, 1, 2}) {
       size_t b = (a + 1) % 3;
-      uint16_t a_x = space.GetVertices()(kX, t * kVerticesPerTriangle + a);
-      uint16_t a_y = space.GetVertices()(kY, t * kVerticesPerTriangle + a);
-      uint16_t b_x = space.GetVertices()(kX, t * kVerticesPerTriangle + b);
-      uint16_t b_y = space.GetVertices()(kY, t * kVerticesPerTriangle + b);
+      int a_x = space.GetVertices()(kX, t * kVerticesPerTriangle + a);
+      int a_y = space.GetVertices()(kY, t * kVerticesPerTriangle + a);
+      int b_x = space.GetVertices()(kX, t * kVerticesPerTriangle + b);
+      int b_y = space.GetVertices()(kY, t * kVerticesPerTriangle + b);
       user_interface.DrawLine(a_x, a_y, b_x, b_y);
     }
   }
 }
 
-ScanlineRasterizer::ScanlineRasterizer() noexcept {}
+ScanlineRasterizer::ScanlineRasterizer() noexcept
+    : depth_tested_(0), depth_passed_(0) {}
 
-void ScanlineRasterizer::RasterizeGameState(
-    const GameState& game_state,
-    UserInterface& user_interface) noexcept {
-  const Space& space = game_state.GetOutputSpace();
+void ScanlineRasterizer::RasterizeSpace(const Space& space,
+                                        UserInterface& user_interface) noexcept {
+  PROFILE_ZONE("ScanlineRasterizer");
+  Resize(user_interface.GetRenderWidth(), user_interface.GetRenderHeight());
+  ResetStatistics();
 
-  ResetZBuffer();
   user_interface.StartFrameRasterization(&pixels_, &pitch_);
-  ClearRenderer();
-
-  for (size_t t = 0; t < space.GetTriangleCount(); t++) {
-    TriangleSharedPointer triangle = space.GetTriangles()[t];
-    // Triangle color
-    Direction light_direction = {1, 2, 3};
-    float brightness = light_direction.GetVector().normalized().dot(
-        triangle->GetNormal().normalized());
-    brightness = (brightness + 1) / 2;
-    uint8_t color_value = brightness * 0xff;
-
-    PixelCoordinates pc;
-    OrderedVertexIndices vi;
-
-    SetSortedVertexIndices(vi, t, space);
-    SetPixelCoordinates(pc, vi, space);
-
-    // Scanlines for top section
-    RasterizeTriangleHalf(pc, vi, triangle, TriangleHalf::kUpper, color_value);
-    // Scanlines for bottom section
-    RasterizeTriangleHalf(pc, vi, triangle, TriangleHalf::kLower, color_value);
+  {
+    PROFILE_ZONE("Clear");
+    ResetZBuffer();
+    ClearRenderer();
+  }
+  {
+    PROFILE_ZONE("RasterizeTriangles");
+    ScreenRectangle screen = GetScreenRectangle();
+    for (size_t t = 0; t < space.GetTriangleCount(); t++)
+      RasterizeTriangle(space, t, screen);
   }
   user_interface.EndFrameRasterization();
 }
 
+void ScanlineRasterizer::RasterizeTriangle(
+    const Space& space,
+    size_t triangle_index,
+    const ScreenRectangle& scissor) noexcept {
+  uint8_t color_value =
+      ::GetTriangleColorValue(space.GetNormals().col(triangle_index));
+
+  PixelCoordinates pc;
+  OrderedVertexIndices vi;
+
+  SetSortedVertexIndices(vi, triangle_index, space);
+  SetPixelCoordinates(pc, vi, space);
+  float nearest_z = ::GetNearestDepth(pc);
+  if (IsTriangleOccluded(pc, scissor, nearest_z))
+    return;
+
+  // Scanlines for top section
+  RasterizeTriangleHalf(pc, vi, TriangleHalf::kUpper, color_value, scissor,
+                        nearest_z);
+  // Scanlines for bottom section
+  RasterizeTriangleHalf(pc, vi, TriangleHalf::kLower, color_value, scissor,
+                        nearest_z);
+}
+
+// Follows the size of the user interface, which may change between frames
+void ScanlineRasterizer::Resize(uint16_t width, uint16_t height) {
+  z_buffer_.Resize(width, height);
+}
+
+ScreenRectangle ScanlineRasterizer::GetScreenRectangle() const noexcept {
+  return {0, 0, static_cast<uint16_t>(z_buffer_.GetWidth() - 1),
+          static_cast<uint16_t>(z_buffer_.GetHeight() - 1)};
+}
+
+// Counters of the last frame. Covered pixels are counted by the depth buffer
+// as it is written, per coarse tile.
+RasterizerStatistics ScanlineRasterizer::GetStatistics() const noexcept {
+  RasterizerStatistics statistics = {depth_tested_, depth_passed_,
+                                     z_buffer_.CountWrittenPixels(), 0};
+  if (statistics.pixels_covered)
+    statistics.overdraw_ratio =
+        static_cast<float>(statistics.depth_passed) /
+        statistics.pixels_covered;
+  return statistics;
+}
+
+void ScanlineRasterizer::ResetStatistics() noexcept {
+  depth_tested_ = 0;
+  depth_passed_ = 0;
+}
+
+void ScanlineRasterizer::AddFragmentCounts(uint64_t depth_tested,
+                                           uint64_t depth_passed) noexcept {
+  depth_tested_.fetch_add(depth_tested, std::memory_order_relaxed);
+  depth_passed_.fetch_add(depth_passed, std::memory_order_relaxed);
+}
+
 void ScanlineRasterizer::ResetZBuffer() noexcept {
-  std::fill(z_buffer_.begin(), z_buffer_.end(), 1);
+  z_buffer_.Reset();
 }
 
 void ScanlineRasterizer::ClearRenderer() noexcept {
   uint8_t* pixels = pixels_;
   int pitch = pitch_;
   uint32_t pixel_value = 0xff008080;
-  for (uint16_t y = 0; y < kWindowHeight; y++)
-    for (uint16_t x = 0; x < kWindowWidth * kBytesPerPixel;
-         x += kBytesPerPixel) {
-      *reinterpret_cast<uint32_t*>(pixels + y * pitch + x) = pixel_value;
-    }
+  uint16_t width = z_buffer_.GetWidth();
+  for (uint16_t y = 0; y < z_buffer_.GetHeight(); y++) {
+    uint32_t* row = reinterpret_cast<uint32_t*>(pixels + y * pitch);
+    std::fill(row, row + width, pixel_value);
+  }
+}
+
+void ScanlineRasterizer::ClearRectangle(
+    const ScreenRectangle& rectangle) noexcept {
+  uint8_t* pixels = pixels_;
+  int pitch = pitch_;
+  uint32_t pixel_value = 0xff008080;
+  for (uint16_t y = rectangle.y_min; y <= rectangle.y_max; y++) {
+    uint32_t* row = reinterpret_cast<uint32_t*>(pixels + y * pitch);
+    std::fill(row + rectangle.x_min, row + rectangle.x_max + 1, pixel_value);
+  }
+  z_buffer_.ResetRectangle(rectangle);
+}
+
+bool ScanlineRasterizer::ZBufferCheckAndReplace(float new_value,
+                                                uint16_t x,
+                                                uint16_t y) noexcept {
+  return z_buffer_.CheckAndReplace(new_value, x, y);
 }
 
-bool ScanlineRasterizer::ZBufferCheckAndReplace(
-    float new_value,
-    uint32_t z_buffer_index) noexcept {
-  if (new_value - 0.001 < z_buffer_[z_buffer_index]) {
-    z_buffer_[z_buffer_index] = new_value;
+// Rejects the triangle if its nearest vertex lies behind everything already
+// drawn in the part of the scissor its bounding box covers
+bool ScanlineRasterizer::IsTriangleOccluded(const PixelCoordinates& pc,
+                                            const ScreenRectangle& scissor,
+                                            float nearest_z) noexcept {
+  int x_min = std::max<int>(std::min({pc.top_x, pc.mid_x, pc.low_x}),
+                            scissor.x_min);
+  int y_min = std::max<int>(std::min({pc.top_y, pc.mid_y, pc.low_y}),
+                            scissor.y_min);
+  int x_max = std::min<int>(std::max({pc.top_x, pc.mid_x, pc.low_x}),
+                            scissor.x_max);
+  int y_max = std::min<int>(std::max({pc.top_y, pc.mid_y, pc.low_y}),
+                            scissor.y_max);
+  if (x_min > x_max || y_min > y_max)
     return true;
-  } else
-    return false;
+  ScreenRectangle bounds = {
+      static_cast<uint16_t>(x_min), static_cast<uint16_t>(y_min),
+      static_cast<uint16_t>(x_max), static_cast<uint16_t>(y_max)};
+  return z_buffer_.IsRectangleOccluded(bounds, nearest_z);
 }
 
 void ScanlineRasterizer::SetSortedVertexIndices(
@@ -184,26 +362,35 @@ void ScanlineRasterizer::SetPixelCoordinates(
     PixelCoordinates& pc,
     const OrderedVertexIndices& vertex_indices,
     const Space& space) const noexcept {
-  pc.top_x = space.GetVertices()(kX, vertex_indices.top);
-  pc.top_y = space.GetVertices()(kY, vertex_indices.top);
+  pc.top_x = ::GetPixelCoordinate(
+      space.GetVertices()(kX, vertex_indices.top));
+  pc.top_y = ::GetPixelCoordinate(
+      space.GetVertices()(kY, vertex_indices.top));
   pc.top_z = space.GetVertices()(kZ, vertex_indices.top);
-  pc.mid_x = space.GetVertices()(kX, vertex_indices.mid);
-  pc.mid_y = space.GetVertices()(kY, vertex_indices.mid);
+  pc.mid_x = ::GetPixelCoordinate(
+      space.GetVertices()(kX, vertex_indices.mid));
+  pc.mid_y = ::GetPixelCoordinate(
+      space.GetVertices()(kY, vertex_indices.mid));
   pc.mid_z = space.GetVertices()(kZ, vertex_indices.mid);
-  pc.low_x = space.GetVertices()(kX, vertex_indices.low);
-  pc.low_y = space.GetVertices()(kY, vertex_indices.low);
+  pc.low_x = ::GetPixelCoordinate(
+      space.GetVertices()(kX, vertex_indices.low));
+  pc.low_y = ::GetPixelCoordinate(
+      space.GetVertices()(kY, vertex_indices.low));
   pc.low_z = space.GetVertices()(kZ, vertex_indices.low);
 }
 
-void ScanlineRasterizer::RasterizeTriangleHalf(
-    PixelCoordinates& pc,
-    OrderedVertexIndices& vi,
-    const TriangleSharedPointer& triangle,
-    TriangleHalf triangle_half,
-    uint8_t color_value) noexcept {
-  (void)triangle;
-  uint8_t* pixels = pixels_;
-  int pitch = pitch_;
+// Walks the scanlines of one half of the triangle within the scissor. The
+// visitor is handed the part of each span, from first_x to last_x in the
+// direction of sp.scan_x_increment, that the coarse depth test could not
+// reject, together with the depths at the span ends; it returns the number
+// of fragments that passed the depth test.
+template <typename SpanVisitor>
+void ScanlineRasterizer::WalkTriangleHalf(PixelCoordinates& pc,
+                                          OrderedVertexIndices& vi,
+                                          TriangleHalf triangle_half,
+                                          const ScreenRectangle& scissor,
+                                          float nearest_z,
+                                          SpanVisitor visit_span) noexcept {
   InterpolationParameters ip;
   ScanlineParameters sp;
 
@@ -214,23 +401,76 @@ void ScanlineRasterizer::RasterizeTriangleHalf(
     return;
 
   ::SetScanlineIncrementY(sp, triangle_half);
-  for (sp.scan_y = pc.top_y;; sp.scan_y += sp.scan_y_increment) {
-    assert(sp.scan_y < kWindowHeight);
+  uint16_t first_y, last_y;
+  if (!::ClampScanRange(pc.top_y, pc.mid_y, sp.scan_y_increment,
+                        scissor.y_min, scissor.y_max, first_y, last_y))
+    return;
+  uint64_t depth_tested = 0;
+  uint64_t depth_passed = 0;
+  for (sp.scan_y = first_y;; sp.scan_y += sp.scan_y_increment) {
+    assert(sp.scan_y < z_buffer_.GetHeight());
     ::CalculateXScanlineBoundaries(sp, pc);
     ::CalculateInterpolationParametersForY(ip, sp, pc);
-    for (sp.scan_x = sp.scan_x_left;; sp.scan_x += sp.scan_x_increment) {
-      assert(sp.scan_x < kWindowWidth);
-      ::CalculateInterpolationParametersForX(ip, sp);
-      if (ZBufferCheckAndReplace(ip.final_z,
-                                 sp.scan_y * kWindowWidth + sp.scan_x)) {
-        WritePixel(color_value, sp, pixels, pitch);
-      }
-      if (sp.scan_x == sp.scan_x_right)
-        break;
+    uint16_t first_x, last_x;
+    if (::ClampScanRange(sp.scan_x_left, sp.scan_x_right, sp.scan_x_increment,
+                         scissor.x_min, scissor.x_max, first_x, last_x) &&
+        z_buffer_.TrimOccludedSpan(first_x, last_x, sp.scan_x_increment,
+                                   sp.scan_y, nearest_z)) {
+      assert(first_x < z_buffer_.GetWidth() && last_x < z_buffer_.GetWidth());
+      depth_tested += std::abs(last_x - first_x) + 1;
+      depth_passed += visit_span(sp, ip, first_x, last_x);
     }
-    if (sp.scan_y == pc.mid_y)
+    if (sp.scan_y == last_y)
       break;
   }
+  AddFragmentCounts(depth_tested, depth_passed);
+}
+
+// Walks the fragments of one half of the triangle within the scissor. The
+// visitor depth tests the fragment at sp.scan_x, sp.scan_y with the given
+// depth and returns whether it passed.
+template <typename FragmentVisitor>
+void ScanlineRasterizer::WalkTriangleHalfFragments(
+    PixelCoordinates& pc,
+    OrderedVertexIndices& vi,
+    TriangleHalf triangle_half,
+    const ScreenRectangle& scissor,
+    float nearest_z,
+    FragmentVisitor visit_fragment) noexcept {
+  WalkTriangleHalf(
+      pc, vi, triangle_half, scissor, nearest_z,
+      [&visit_fragment](ScanlineParameters& sp, InterpolationParameters& ip,
+                        uint16_t first_x, uint16_t last_x) {
+        uint64_t depth_passed = 0;
+        for (sp.scan_x = first_x;; sp.scan_x += sp.scan_x_increment) {
+          ::CalculateInterpolationParametersForX(ip, sp);
+          if (visit_fragment(sp, ip.final_z))
+            depth_passed++;
+          if (sp.scan_x == last_x)
+            break;
+        }
+        return depth_passed;
+      });
+}
+
+void ScanlineRasterizer::RasterizeTriangleHalf(
+    PixelCoordinates& pc,
+    OrderedVertexIndices& vi,
+    TriangleHalf triangle_half,
+    uint8_t color_value,
+    const ScreenRectangle& scissor,
+    float nearest_z) noexcept {
+  uint8_t* pixels = pixels_;
+  int pitch = pitch_;
+  WalkTriangleHalfFragments(
+      pc, vi, triangle_half, scissor, nearest_z,
+      [this, color_value, pixels, pitch](const ScanlineParameters& sp,
+                                         float z) {
+        if (!ZBufferCheckAndReplace(z, sp.scan_x, sp.scan_y))
+          return false;
+        WritePixel(color_value, sp, pixels, pitch);
+        return true;
+      });
 }
 
 void ScanlineRasterizer::WritePixel(uint8_t color_value,
@@ -244,81 +484,387 @@ void ScanlineRasterizer::WritePixel(uint8_t color_value,
   pixels[index + 3] = 0xff;
 }
 
-FlatRasterizer::FlatRasterizer() noexcept : FlatRasterizer({1, 1, 1}) {}
+EdgeFunctionRasterizer::EdgeFunctionRasterizer() noexcept {}
+
+void EdgeFunctionRasterizer::RasterizeTriangle(
+    const Space& space,
+    size_t triangle_index,
+    const ScreenRectangle& scissor) noexcept {
+  PixelCoordinates pc;
+  OrderedVertexIndices vi;
+  SetSortedVertexIndices(vi, triangle_index, space);
+  SetPixelCoordinates(pc, vi, space);
+  if (pc.top_y == pc.low_y)
+    return;
 
-FlatRasterizer::FlatRasterizer(Direction light_direction) noexcept
-    : light_direction_(light_direction) {}
+  // The long edge runs from top to low; the short edges lie on the other side
+  int orientation = (pc.mid_x - pc.top_x) * (pc.low_y - pc.top_y) -
+                    (pc.low_x - pc.top_x) * (pc.mid_y - pc.top_y);
+  if (orientation == 0)
+    return;
+  bool long_edge_is_left = orientation > 0;
+  std::array<EdgeFunction, kVerticesPerTriangle> edges = {
+      ::GetEdgeFunction(pc.top_x, pc.top_y, pc.low_x, pc.low_y,
+                        long_edge_is_left),
+      ::GetEdgeFunction(pc.top_x, pc.top_y, pc.mid_x, pc.mid_y,
+                        !long_edge_is_left),
+      ::GetEdgeFunction(pc.mid_x, pc.mid_y, pc.low_x, pc.low_y,
+                        !long_edge_is_left)};
+
+  // Depth plane z = z_x * x + z_y * y + z_c through the three vertices
+  float mid_dz = pc.mid_z - pc.top_z;
+  float low_dz = pc.low_z - pc.top_z;
+  float z_x = (mid_dz * (pc.low_y - pc.top_y) - low_dz * (pc.mid_y - pc.top_y)) /
+              orientation;
+  float z_y = (low_dz * (pc.mid_x - pc.top_x) - mid_dz * (pc.low_x - pc.top_x)) /
+              orientation;
+  float z_c = pc.top_z - z_x * pc.top_x - z_y * pc.top_y;
+
+  int first_y = std::max<int>(pc.top_y, scissor.y_min);
+  int last_y = std::min<int>(pc.low_y, scissor.y_max);
+  int first_x =
+      std::max<int>(std::min({pc.top_x, pc.mid_x, pc.low_x}), scissor.x_min);
+  int last_x =
+      std::min<int>(std::max({pc.top_x, pc.mid_x, pc.low_x}), scissor.x_max);
+  if (first_y > last_y || first_x > last_x)
+    return;
+  // Covered pixels may lie slightly outside the triangle of the truncated
+  // vertices, so the nearest depth is taken from the plane at the corners
+  ScreenRectangle bounds = {
+      static_cast<uint16_t>(first_x), static_cast<uint16_t>(first_y),
+      static_cast<uint16_t>(last_x), static_cast<uint16_t>(last_y)};
+  float nearest_z = z_c + std::min(z_x * first_x, z_x * last_x) +
+                    std::min(z_y * first_y, z_y * last_y);
+  if (z_buffer_.IsRectangleOccluded(bounds, nearest_z))
+    return;
+  // Blocks start on multiples of the vector width, so that none of them
+  // straddles a coarse depth tile or a rasterizer tile
+  int first_block_x = first_x - first_x % kSimdWidth;
+  const int width = z_buffer_.GetWidth();
+
+  uint8_t color_value =
+      ::GetTriangleColorValue(space.GetNormals().col(triangle_index));
+  const FloatBlock color = SimdBroadcastBits(
+      0xff000000 | color_value << 16 | color_value << 8 | color_value);
+  const FloatBlock lane_offsets = SimdLaneOffsets();
+  const FloatBlock zero = SimdBroadcast(0);
+  const FloatBlock first_x_block = SimdBroadcast(first_x);
+  const FloatBlock last_x_block = SimdBroadcast(last_x);
+  const FloatBlock z_bias = SimdBroadcast(kDepthBias);
+  const FloatBlock clear_depth = SimdBroadcast(kClearDepth);
+  FloatBlock a[kVerticesPerTriangle];
+  FloatBlock steps[kVerticesPerTriangle];
+  for (size_t e = 0; e < kVerticesPerTriangle; e++) {
+    a[e] = SimdBroadcast(edges[e].a);
+    // F(x + 1) for right edges and F(x - 1) for left edges, both of which
+    // move away from the inner side
+    steps[e] = SimdBroadcast(-std::fabs(edges[e].a));
+  }
+  const FloatBlock z_x_block = SimdBroadcast(z_x);
+  alignas(32) float partial_z[kSimdWidth];
+  alignas(32) uint32_t partial_pixels[kSimdWidth];
+  uint64_t depth_tested = 0;
+  uint64_t depth_passed = 0;
+
+  for (int y = first_y; y <= last_y; y++) {
+    FloatBlock row[kVerticesPerTriangle];
+    for (size_t e = 0; e < kVerticesPerTriangle; e++)
+      row[e] = SimdBroadcast(edges[e].b * y + edges[e].c);
+    const FloatBlock z_row = SimdBroadcast(z_y * y + z_c);
+    float* z_pointer = z_buffer_.GetRow(y);
+    uint32_t* pixel_pointer = reinterpret_cast<uint32_t*>(pixels_ + y * pitch_);
+    for (int x = first_block_x; x <= last_x; x += kSimdWidth) {
+      if (z_buffer_.IsTileOccluded(x, y, nearest_z))
+        continue;
+      FloatBlock xs = SimdAdd(SimdBroadcast(x), lane_offsets);
+      // Inside test and the neighbouring pixel test that rejects the
+      // single-pixel spans skipped by the scanline walk
+      FloatBlock f_long = SimdAdd(SimdMultiply(a[0], xs), row[0]);
+      FloatBlock f_short_1 = SimdAdd(SimdMultiply(a[1], xs), row[1]);
+      FloatBlock f_short_2 = SimdAdd(SimdMultiply(a[2], xs), row[2]);
+      FloatBlock mask = SimdAnd(
+          SimdAnd(SimdGreaterEqual(f_long, zero),
+                  SimdGreaterEqual(f_short_1, zero)),
+          SimdAnd(SimdGreaterEqual(f_short_2, zero),
+                  SimdAnd(SimdGreaterEqual(xs, first_x_block),
+                          SimdLessEqual(xs, last_x_block))));
+      FloatBlock long_next = SimdGreaterEqual(SimdAdd(f_long, steps[0]), zero);
+      FloatBlock short_next =
+          SimdAnd(SimdGreaterEqual(SimdAdd(f_short_1, steps[1]), zero),
+                  SimdGreaterEqual(SimdAdd(f_short_2, steps[2]), zero));
+      mask = SimdAnd(mask, SimdOr(long_next, short_next));
+      int covered_lanes = SimdMoveMask(mask);
+      if (!covered_lanes)
+        continue;
+      depth_tested += __builtin_popcount(covered_lanes);
+
+      size_t lanes = std::min<size_t>(kSimdWidth, width - x);
+      float* z_target = z_pointer + x;
+      uint32_t* pixel_target = pixel_pointer + x;
+      if (lanes < kSimdWidth) {
+        std::memcpy(partial_z, z_target, lanes * sizeof(float));
+        std::memcpy(partial_pixels, pixel_target, lanes * sizeof(uint32_t));
+        z_target = partial_z;
+        pixel_target = partial_pixels;
+      }
+      FloatBlock z = SimdAdd(SimdMultiply(z_x_block, xs), z_row);
+      FloatBlock z_buffer = SimdLoad(z_target);
+      mask = SimdAnd(mask, SimdLess(SimdSubtract(z, z_bias), z_buffer));
+      int passed_lanes = SimdMoveMask(mask);
+      if (!passed_lanes)
+        continue;
+      depth_passed += __builtin_popcount(passed_lanes);
+      int newly_written_lanes =
+          SimdMoveMask(SimdAnd(mask, SimdEqual(z_buffer, clear_depth)));
+      SimdStore(z_target, SimdSelect(mask, z, z_buffer));
+      SimdStore(pixel_target, SimdSelect(mask, color, SimdLoad(pixel_target)));
+      if (lanes < kSimdWidth) {
+        std::memcpy(z_pointer + x, partial_z, lanes * sizeof(float));
+        std::memcpy(pixel_pointer + x, partial_pixels,
+                    lanes * sizeof(uint32_t));
+      }
+      z_buffer_.MarkWritten(x, y, __builtin_popcount(newly_written_lanes));
+    }
+  }
+  AddFragmentCounts(depth_tested, depth_passed);
+}
 
-TexturedRasterizer::TexturedRasterizer() noexcept
-    : texture_("assets/blender/porcelain.png") {}
+OverdrawRasterizer::OverdrawRasterizer() noexcept
+    : OverdrawRasterizer(HeatmapMetric::kFragmentWrites) {}
 
-inline void TexturedRasterizer::RasterizeTriangleHalf(
+OverdrawRasterizer::OverdrawRasterizer(HeatmapMetric metric) noexcept
+    : metric_(metric) {}
+
+void OverdrawRasterizer::Resize(uint16_t width, uint16_t height) {
+  ScanlineRasterizer::Resize(width, height);
+  if (fragment_writes_.size() != static_cast<size_t>(width) * height) {
+    fragment_writes_ = AlignedBuffer<uint16_t>(width * height);
+    depth_tests_ = AlignedBuffer<uint16_t>(width * height);
+  }
+}
+
+void OverdrawRasterizer::RasterizeSpace(const Space& space,
+                                        UserInterface& user_interface) noexcept {
+  PROFILE_ZONE("OverdrawRasterizer");
+  Resize(user_interface.GetRenderWidth(), user_interface.GetRenderHeight());
+  ResetStatistics();
+  user_interface.StartFrameRasterization(&pixels_, &pitch_);
+  ResetZBuffer();
+  fragment_writes_.fill(0);
+  depth_tests_.fill(0);
+  ScreenRectangle screen = GetScreenRectangle();
+  for (size_t t = 0; t < space.GetTriangleCount(); t++)
+    RasterizeTriangle(space, t, screen);
+  WriteHeatmap();
+  user_interface.EndFrameRasterization();
+}
+
+// Depth complexity counts every fragment of the triangle, so the triangle
+// and its spans bypass the hierarchical depth buffer, which would otherwise
+// drop the occluded layers before they are tested.
+void OverdrawRasterizer::RasterizeTriangle(
+    const Space& space,
+    size_t triangle_index,
+    const ScreenRectangle& scissor) noexcept {
+  if (metric_ != HeatmapMetric::kDepthTests) {
+    ScanlineRasterizer::RasterizeTriangle(space, triangle_index, scissor);
+    return;
+  }
+  PixelCoordinates pc;
+  OrderedVertexIndices vi;
+  SetSortedVertexIndices(vi, triangle_index, space);
+  SetPixelCoordinates(pc, vi, space);
+  const float never_occluded_z = -std::numeric_limits<float>::infinity();
+  RasterizeTriangleHalf(pc, vi, TriangleHalf::kUpper, 0, scissor,
+                        never_occluded_z);
+  RasterizeTriangleHalf(pc, vi, TriangleHalf::kLower, 0, scissor,
+                        never_occluded_z);
+}
+
+void OverdrawRasterizer::RasterizeTriangleHalf(
     PixelCoordinates& pc,
     OrderedVertexIndices& vi,
-    const TriangleSharedPointer& triangle,
     TriangleHalf triangle_half,
-    uint8_t color_value) noexcept {
-  (void)color_value;
-  uint8_t* pixels = pixels_;
-  int pitch = pitch_;
-  InterpolationParameters ip;
-  ScanlineParameters sp;
+    uint8_t,
+    const ScreenRectangle& scissor,
+    float nearest_z) noexcept {
+  const uint16_t width = z_buffer_.GetWidth();
+  WalkTriangleHalfFragments(
+      pc, vi, triangle_half, scissor, nearest_z,
+      [this, width](const ScanlineParameters& sp, float z) {
+        size_t index = sp.scan_y * width + sp.scan_x;
+        depth_tests_[index]++;
+        if (!ZBufferCheckAndReplace(z, sp.scan_x, sp.scan_y))
+          return false;
+        fragment_writes_[index]++;
+        return true;
+      });
+}
 
-  if (triangle_half == TriangleHalf::kLower)
-    ::SwapTopAndLow(pc, vi);
+void OverdrawRasterizer::WriteHeatmap() noexcept {
+  const AlignedBuffer<uint16_t>& counts =
+      metric_ == HeatmapMetric::kFragmentWrites ? fragment_writes_
+                                                : depth_tests_;
+  const uint16_t width = z_buffer_.GetWidth();
+  for (uint16_t y = 0; y < z_buffer_.GetHeight(); y++) {
+    uint32_t* row = reinterpret_cast<uint32_t*>(pixels_ + y * pitch_);
+    for (uint16_t x = 0; x < width; x++)
+      row[x] = ::GetHeatmapColor(counts[y * width + x]);
+  }
+}
 
-  if (pc.low_y == pc.top_y || pc.top_y == pc.mid_y)  // #TODO: Best timing?
-    return;
+FlatRasterizer::FlatRasterizer() noexcept : FlatRasterizer({1, 1, 1}) {}
 
-  UVCoordinate top_uv =
-      triangle->GetVertex(vi.top % kVerticesPerTriangle).GetUVCoordinate();
-  UVCoordinate mid_uv =
-      triangle->GetVertex(vi.mid % kVerticesPerTriangle).GetUVCoordinate();
-  UVCoordinate low_uv =
-      triangle->GetVertex(vi.low % kVerticesPerTriangle).GetUVCoordinate();
+FlatRasterizer::FlatRasterizer(Direction light_direction) noexcept
+    : light_direction_(light_direction) {}
 
-  ::SetScanlineIncrementY(sp, triangle_half);
-  for (sp.scan_y = pc.top_y;; sp.scan_y += sp.scan_y_increment) {
-    assert(sp.scan_y < kWindowHeight);
-    ::CalculateXScanlineBoundaries(sp, pc);
-    ::CalculateInterpolationParametersForY(ip, sp, pc);
+TexturedRasterizer::TexturedRasterizer() noexcept
+    : texture_("assets/blender/porcelain.png") {}
 
-    Vector2 top_low_uv = (top_uv / ::TrueZ(pc.top_z)) * (1 - ip.top_low_t) +
-                         (low_uv / ::TrueZ(pc.low_z)) * (ip.top_low_t);
-    top_low_uv *= ::TrueZ(ip.top_low_z);
+void TexturedRasterizer::RasterizeTriangle(
+    const Space& space,
+    size_t triangle_index,
+    const ScreenRectangle& scissor) noexcept {
+  TriangleSetup setup;
+  if (SetUpTriangle(setup, space, triangle_index))
+    RasterizeSetUpTriangle(setup, scissor);
+}
 
-    Vector2 top_mid_uv = (top_uv / ::TrueZ(pc.top_z)) * (1 - ip.top_mid_t) +
-                         (mid_uv / ::TrueZ(pc.mid_z)) * (ip.top_mid_t);
-    top_mid_uv *= ::TrueZ(ip.top_mid_z);
+// Returns false for degenerate triangles that cover no pixels
+bool TexturedRasterizer::SetUpTriangle(TriangleSetup& setup,
+                                       const Space& space,
+                                       size_t triangle_index) const noexcept {
+  SetSortedVertexIndices(setup.vertex_indices, triangle_index, space);
+  SetPixelCoordinates(setup.pixel_coordinates, setup.vertex_indices, space);
+  setup.nearest_z = ::GetNearestDepth(setup.pixel_coordinates);
+  return SetPerspectiveGradients(setup.gradients, setup.pixel_coordinates,
+                                 setup.vertex_indices,
+                                 space.GetUVCoordinates());
+}
 
-    for (sp.scan_x = sp.scan_x_left;; sp.scan_x += sp.scan_x_increment) {
-      assert(sp.scan_x < kWindowWidth);
-      ::CalculateInterpolationParametersForX(ip, sp);
+// Only the occlusion query depends on the scissor rectangle, as it looks up
+// the depth drawn within it so far
+void TexturedRasterizer::RasterizeSetUpTriangle(
+    const TriangleSetup& setup,
+    const ScreenRectangle& scissor) noexcept {
+  if (IsTriangleOccluded(setup.pixel_coordinates, scissor, setup.nearest_z))
+    return;
+  PixelCoordinates pc = setup.pixel_coordinates;
+  OrderedVertexIndices vi = setup.vertex_indices;
+  RasterizeTexturedHalf(pc, vi, TriangleHalf::kUpper, setup.gradients, scissor,
+                        setup.nearest_z);
+  RasterizeTexturedHalf(pc, vi, TriangleHalf::kLower, setup.gradients, scissor,
+                        setup.nearest_z);
+}
 
-      Vector2 final_uv =
-          (top_low_uv / ::TrueZ(ip.top_low_z)) * (1 - ip.horizontal_t) +
-          (top_mid_uv / ::TrueZ(ip.top_mid_z)) * (ip.horizontal_t);
-      final_uv *= ::TrueZ(ip.final_z);
+// Screen-space plane equations for 1/w, u/w and v/w, which are affine in
+// screen space unlike u and v themselves. Returns false for degenerate
+// triangles that cover no pixels.
+bool TexturedRasterizer::SetPerspectiveGradients(
+    PerspectiveGradients& gradients,
+    const PixelCoordinates& pc,
+    const OrderedVertexIndices& vi,
+    const UVMatrixView& uv_coordinates) const noexcept {
+  int mid_dx = pc.mid_x - pc.top_x;
+  int mid_dy = pc.mid_y - pc.top_y;
+  int low_dx = pc.low_x - pc.top_x;
+  int low_dy = pc.low_y - pc.top_y;
+  float determinant = mid_dx * low_dy - low_dx * mid_dy;
+  if (determinant == 0)
+    return false;
+  auto attributes = [&uv_coordinates](size_t vertex_index, float z) {
+    float reciprocal_w = ::ReciprocalTrueZ(z);
+    Vector2 uv = uv_coordinates.col(vertex_index);
+    return Vector3(reciprocal_w, uv[kU] * reciprocal_w, uv[kV] * reciprocal_w);
+  };
+  Vector3 top = attributes(vi.top, pc.top_z);
+  Vector3 mid_delta = attributes(vi.mid, pc.mid_z) - top;
+  Vector3 low_delta = attributes(vi.low, pc.low_z) - top;
+  gradients.reference = top;
+  gradients.reference_x = pc.top_x;
+  gradients.reference_y = pc.top_y;
+  gradients.d_dx = (mid_delta * low_dy - low_delta * mid_dy) / determinant;
+  gradients.d_dy = (low_delta * mid_dx - mid_delta * low_dx) / determinant;
+  return true;
+}
 
-      if (ZBufferCheckAndReplace(ip.final_z,
-                                 sp.scan_y * kWindowWidth + sp.scan_x)) {
-        WritePixel(sp, pixels, pitch, final_uv);
-      }
-      if (sp.scan_x == sp.scan_x_right)
-        break;
-    }
-    if (sp.scan_y == pc.mid_y)
-      break;
-  }
+void TexturedRasterizer::RasterizeTexturedHalf(
+    PixelCoordinates& pc,
+    OrderedVertexIndices& vi,
+    TriangleHalf triangle_half,
+    const PerspectiveGradients& gradients,
+    const ScreenRectangle& scissor,
+    float nearest_z) noexcept {
+  uint8_t* pixels = pixels_;
+  int pitch = pitch_;
+  WalkTriangleHalf(
+      pc, vi, triangle_half, scissor, nearest_z,
+      [this, &gradients, pixels, pitch](ScanlineParameters& sp,
+                                        const InterpolationParameters& ip,
+                                        uint16_t first_x, uint16_t last_x) {
+        // Depth is affine along the scanline; a zero-length span yields NaN
+        // and is rejected by the depth test just like in ScanlineRasterizer
+        float z_dx = (ip.top_mid_z - ip.top_low_z) /
+                     (sp.scan_x_right - sp.scan_x_left);
+        Vector3 row_attributes =
+            gradients.reference - gradients.d_dx * gradients.reference_x +
+            gradients.d_dy * (sp.scan_y - gradients.reference_y);
+        auto get_uv = [&row_attributes, &gradients](int x) {
+          Vector3 attributes = row_attributes + gradients.d_dx * x;
+          return Vector2(attributes.tail<2>() / attributes[0]);
+        };
+
+        // One reciprocal per block of kPerspectiveSpanLength screen columns,
+        // with UVs linear in between. Depth and UVs are evaluated per pixel
+        // from the block boundaries rather than accumulated from the first
+        // pixel, so that where the scissor or the coarse depth test starts a
+        // span does not alter the result. The boundaries are clamped to the
+        // unscissored span: beyond the triangle, 1/w may reach zero.
+        const int span_min = std::min(sp.scan_x_left, sp.scan_x_right);
+        const int span_max = std::max(sp.scan_x_left, sp.scan_x_right);
+        int block_x, block_start;
+        Vector2 block_uv, uv_dx;
+        auto start_block = [&](int x) {
+          block_x = x - x % kPerspectiveSpanLength;
+          block_start = std::clamp(block_x, span_min, span_max);
+          int block_end =
+              std::clamp(block_x + kPerspectiveSpanLength, span_min, span_max);
+          block_uv = get_uv(block_start);
+          uv_dx = block_end > block_start
+                      ? Vector2((get_uv(block_end) - block_uv) /
+                                (block_end - block_start))
+                      : Vector2::Zero();
+        };
+        uint64_t depth_passed = 0;
+        start_block(first_x);
+        for (sp.scan_x = first_x;; sp.scan_x += sp.scan_x_increment) {
+          if (sp.scan_x < block_x ||
+              sp.scan_x >= block_x + kPerspectiveSpanLength)
+            start_block(sp.scan_x);
+          float z = ip.top_low_z + (sp.scan_x - sp.scan_x_left) * z_dx;
+          if (ZBufferCheckAndReplace(z, sp.scan_x, sp.scan_y)) {
+            WritePixel(sp, pixels, pitch,
+                       block_uv + uv_dx * (sp.scan_x - block_start));
+            depth_passed++;
+          }
+          if (sp.scan_x == last_x)
+            break;
+        }
+        return depth_passed;
+      });
 }
+
 inline void TexturedRasterizer::WritePixel(const ScanlineParameters& sp,
                                            uint8_t* pixels,
                                            int pitch,
                                            const Vector2& uv) noexcept {
-  uint16_t u = static_cast<uint16_t>(uv[kU] * (texture_.GetWidth() - 1)) %
+  // Written so that NaN clamps to 0 as well, keeping the casts below defined
+  float clamped_u = std::min(std::max(0.0f, uv[kU]), 1.0f);
+  float clamped_v = std::min(std::max(0.0f, uv[kV]), 1.0f);
+  uint16_t u = static_cast<uint16_t>(clamped_u * (texture_.GetWidth() - 1)) %
                texture_.GetWidth();
   uint16_t v =
-      static_cast<uint16_t>((1 - uv[kV]) * (texture_.GetHeight() - 1)) %
+      static_cast<uint16_t>((1 - clamped_v) * (texture_.GetHeight() - 1)) %
       texture_.GetHeight();
   assert(u < texture_.GetWidth());
   assert(v < texture_.GetHeight());
@@ -329,4 +875,102 @@ inline void TexturedRasterizer::WritePixel(const ScanlineParameters& sp,
   uint32_t target_offset = sp.scan_y * pitch + sp.scan_x * kBytesPerPixel;
   uint32_t* target_pixel = reinterpret_cast<uint32_t*>(pixels + target_offset);
   *target_pixel = *texture_pixel;
-}
\ No newline at end of file
+}
+
+TiledRasterizer::TiledRasterizer() noexcept
+    : TiledRasterizer(JobSystem::GetInstance()) {}
+
+TiledRasterizer::TiledRasterizer(JobSystem& job_system) noexcept
+    : tile_columns_(0), job_system_(job_system) {}
+
+void TiledRasterizer::Resize(uint16_t width, uint16_t height) {
+  ScanlineRasterizer::Resize(width, height);
+  size_t tile_columns = (width + kRasterizerTileSize - 1) / kRasterizerTileSize;
+  size_t tile_rows = (height + kRasterizerTileSize - 1) / kRasterizerTileSize;
+  tile_columns_ = tile_columns;
+  tile_bins_.resize(tile_columns * tile_rows);
+}
+
+void TiledRasterizer::RasterizeSpace(const Space& space,
+                                     UserInterface& user_interface) noexcept {
+  PROFILE_ZONE("TiledRasterizer");
+  Resize(user_interface.GetRenderWidth(), user_interface.GetRenderHeight());
+  ResetStatistics();
+  user_interface.StartFrameRasterization(&pixels_, &pitch_);
+  SetUpTriangles(space);
+  BinTriangles(space);
+  job_system_.ParallelFor(tile_bins_.size(),
+                          [this](size_t tile) { RasterizeTile(tile); });
+  user_interface.EndFrameRasterization();
+}
+
+// In parallel chunks of kTriangleSetupChunkSize triangles, into buffers that
+// are kept across frames
+void TiledRasterizer::SetUpTriangles(const Space& space) noexcept {
+  PROFILE_ZONE("SetUpTriangles");
+  const size_t triangle_count = space.GetTriangleCount();
+  if (triangle_setups_.size() < triangle_count) {
+    triangle_setups_.resize(triangle_count);
+    triangle_degenerate_.resize(triangle_count);
+  }
+  size_t chunk_count =
+      (triangle_count + kTriangleSetupChunkSize - 1) / kTriangleSetupChunkSize;
+  job_system_.ParallelFor(
+      chunk_count, [this, &space, triangle_count](size_t chunk) {
+        size_t end =
+            std::min(triangle_count, (chunk + 1) * kTriangleSetupChunkSize);
+        for (size_t t = chunk * kTriangleSetupChunkSize; t < end; t++)
+          triangle_degenerate_[t] =
+              !SetUpTriangle(triangle_setups_[t], space, t);
+      });
+}
+
+// Every tile that the bounding box of the pixel coordinates overlaps on
+// screen; guard-band triangles may extend beyond the screen on any side
+void TiledRasterizer::BinTriangles(const Space& space) noexcept {
+  PROFILE_ZONE("BinTriangles");
+  for (std::vector<uint32_t>& bin : tile_bins_)
+    bin.clear();
+  const ScreenRectangle screen = GetScreenRectangle();
+  for (size_t t = 0; t < space.GetTriangleCount(); t++) {
+    if (triangle_degenerate_[t])
+      continue;
+    const PixelCoordinates& pc = triangle_setups_[t].pixel_coordinates;
+    int x_min = std::max<int>(std::min({pc.top_x, pc.mid_x, pc.low_x}), 0);
+    int x_max =
+        std::min<int>(std::max({pc.top_x, pc.mid_x, pc.low_x}), screen.x_max);
+    int y_min = std::max<int>(pc.top_y, 0);
+    int y_max = std::min<int>(pc.low_y, screen.y_max);
+    if (x_min > x_max || y_min > y_max)
+      continue;
+    size_t first_column = x_min / kRasterizerTileSize;
+    size_t last_column = x_max / kRasterizerTileSize;
+    size_t first_row = y_min / kRasterizerTileSize;
+    size_t last_row = y_max / kRasterizerTileSize;
+    assert(last_column < tile_columns_ &&
+           (last_row + 1) * tile_columns_ <= tile_bins_.size());
+    for (size_t row = first_row; row <= last_row; row++)
+      for (size_t column = first_column; column <= last_column; column++)
+        tile_bins_[row * tile_columns_ + column].push_back(t);
+  }
+}
+
+void TiledRasterizer::RasterizeTile(size_t tile_index) noexcept {
+  PROFILE_ZONE("RasterizeTile");
+  ScreenRectangle tile = GetTileRectangle(tile_index);
+  ClearRectangle(tile);
+  for (uint32_t t : tile_bins_[tile_index])
+    RasterizeSetUpTriangle(triangle_setups_[t], tile);
+}
+
+ScreenRectangle TiledRasterizer::GetTileRectangle(
+    size_t tile_index) const noexcept {
+  uint16_t x_min = (tile_index % tile_columns_) * kRasterizerTileSize;
+  uint16_t y_min = (tile_index / tile_columns_) * kRasterizerTileSize;
+  ScreenRectangle screen = GetScreenRectangle();
+  return {x_min, y_min,
+          static_cast<uint16_t>(std::min<int>(
+              x_min + kRasterizerTileSize - 1, screen.x_max)),
+          static_cast<uint16_t>(std::min<int>(
+              y_min + kRasterizerTileSize - 1, screen.y_max))};
+}
@@ -3,10 +3,14 @@
 
 #include <SDL2/SDL.h>
 
+#include <atomic>
+
 #include "geometry/direction.hpp"
 #include "geometry/texture.hpp"
 #include "server/game_state.hpp"
 #include "ui/ui.hpp"
+#include "ui/z_buffer.hpp"
+#include "utility/job_system.hpp"
 
 typedef struct OrderedVertexIndices {
   size_t top;
@@ -14,15 +18,17 @@ typedef struct OrderedVertexIndices {
   size_t low;
 } OrderedVertexIndices;
 
+// Vertices may lie off screen within the guard band, so the coordinates are
+// signed and every scan range is clamped to the scissor rectangle.
 typedef struct PixelCoordinates {
-  uint16_t top_x;
-  uint16_t top_y;
+  int16_t top_x;
+  int16_t top_y;
   float top_z;
-  uint16_t mid_x;
-  uint16_t mid_y;
+  int16_t mid_x;
+  int16_t mid_y;
   float mid_z;
-  uint16_t low_x;
-  uint16_t low_y;
+  int16_t low_x;
+  int16_t low_y;
   float low_z;
 } PixelCoordinates;
 
@@ -38,59 +44,136 @@ typedef struct InterpolationParameters {
 typedef struct ScanlineParameters {
   uint16_t scan_x;
   uint16_t scan_y;
-  uint16_t scan_x_left;
-  uint16_t scan_x_right;
+  int16_t scan_x_left;
+  int16_t scan_x_right;
   int8_t scan_x_increment;
   int8_t scan_y_increment;
 } ScanlineParameters;
 
+// Screen-space plane equations of (1/w, u/w, v/w) for a triangle, relative
+// to the pixel of its top vertex.
+typedef struct PerspectiveGradients {
+  Vector3 reference;
+  Vector3 d_dx;
+  Vector3 d_dy;
+  int16_t reference_x;
+  int16_t reference_y;
+} PerspectiveGradients;
+
+// Screen-space edge function F(x, y) = a * x + b * y + c, set up so that
+// F >= 0 for pixels on the inner side of the edge.
+typedef struct EdgeFunction {
+  float a;
+  float b;
+  float c;
+} EdgeFunction;
+
+// Per-triangle state of the textured scanline walk that does not depend on
+// the scissor rectangle, so that it is set up once however many tiles the
+// triangle covers
+typedef struct TriangleSetup {
+  PixelCoordinates pixel_coordinates;
+  OrderedVertexIndices vertex_indices;
+  PerspectiveGradients gradients;
+  float nearest_z;
+} TriangleSetup;
+
 class Rasterizer {
  public:
-  virtual void RasterizeGameState(const GameState& game_state,
-                                  UserInterface& user_interface) noexcept = 0;
+  virtual ~Rasterizer() = default;
+  void RasterizeGameState(const GameState& game_state,
+                          UserInterface& user_interface) noexcept;
+  virtual void RasterizeSpace(const Space& space,
+                              UserInterface& user_interface) noexcept = 0;
+  virtual RasterizerStatistics GetStatistics() const noexcept;
 };
 
 class WireframeRasterizer : public Rasterizer {
  public:
-  virtual void RasterizeGameState(
-      const GameState& game_state,
-      UserInterface& user_interface) noexcept override;
+  virtual void RasterizeSpace(const Space& space,
+                              UserInterface& user_interface) noexcept override;
 };
 
 class ScanlineRasterizer : public Rasterizer {
  public:
   ScanlineRasterizer() noexcept;
-  virtual void RasterizeGameState(
-      const GameState& game_state,
-      UserInterface& user_interface) noexcept override;
+  virtual void RasterizeSpace(const Space& space,
+                              UserInterface& user_interface) noexcept override;
+  virtual RasterizerStatistics GetStatistics() const noexcept override;
 
  protected:
+  virtual void Resize(uint16_t width, uint16_t height);
+  ScreenRectangle GetScreenRectangle() const noexcept;
+  void ResetStatistics() noexcept;
+  void AddFragmentCounts(uint64_t depth_tested, uint64_t depth_passed) noexcept;
   void ResetZBuffer() noexcept;
   void ClearRenderer() noexcept;
+  void ClearRectangle(const ScreenRectangle& rectangle) noexcept;
   bool ZBufferCheckAndReplace(float new_value,
-                              uint32_t z_buffer_index) noexcept;
-  std::array<float, kWindowWidth * kWindowHeight> z_buffer_;
-  uint8_t* pixels_;
-  int pitch_;
-
- private:
+                              uint16_t x,
+                              uint16_t y) noexcept;
+  bool IsTriangleOccluded(const PixelCoordinates& pc,
+                          const ScreenRectangle& scissor,
+                          float nearest_z) noexcept;
+  virtual void RasterizeTriangle(const Space& space,
+                                 size_t triangle_index,
+                                 const ScreenRectangle& scissor) noexcept;
   void SetSortedVertexIndices(OrderedVertexIndices& vi,
                               const size_t triangle_index,
                               const Space& space) const noexcept;
   void SetPixelCoordinates(PixelCoordinates& pc,
                            const OrderedVertexIndices& vertex_indices,
                            const Space& space) const noexcept;
+  template <typename SpanVisitor>
+  void WalkTriangleHalf(PixelCoordinates& pc,
+                        OrderedVertexIndices& vi,
+                        TriangleHalf triangle_half,
+                        const ScreenRectangle& scissor,
+                        float nearest_z,
+                        SpanVisitor visit_span) noexcept;
+  template <typename FragmentVisitor>
+  void WalkTriangleHalfFragments(PixelCoordinates& pc,
+                                 OrderedVertexIndices& vi,
+                                 TriangleHalf triangle_half,
+                                 const ScreenRectangle& scissor,
+                                 float nearest_z,
+                                 FragmentVisitor visit_fragment) noexcept;
+  HierarchicalZBuffer z_buffer_;
+  uint8_t* pixels_;
+  int pitch_;
+  // Summed once per triangle, as tiles are rasterized in parallel
+  std::atomic<uint64_t> depth_tested_;
+  std::atomic<uint64_t> depth_passed_;
+
+ private:
   virtual void RasterizeTriangleHalf(PixelCoordinates& pc,
                                      OrderedVertexIndices& vi,
-                                     const TriangleSharedPointer& triangle,
                                      TriangleHalf triangle_half,
-                                     uint8_t color_value) noexcept;
+                                     uint8_t color_value,
+                                     const ScreenRectangle& scissor,
+                                     float nearest_z) noexcept;
   void WritePixel(uint8_t color_value,
                   const ScanlineParameters& sp,
                   uint8_t* pixels,
                   int pitch) noexcept;
 };
 
+// Evaluates the edge functions of a triangle for a block of kSimdWidth
+// pixels at a time within its bounding box. The coverage rule reproduces the
+// spans of ScanlineRasterizer, so both cover the same pixels; depth comes
+// from the plane of the triangle and differs from the scanline walk by up to
+// the depth step of about one pixel.
+class EdgeFunctionRasterizer : public ScanlineRasterizer {
+ public:
+  EdgeFunctionRasterizer() noexcept;
+
+ protected:
+  virtual void RasterizeTriangle(const Space& space,
+                                 size_t triangle_index,
+                                 const ScreenRectangle& scissor) noexcept
+      override;
+};
+
 class FlatRasterizer : public ScanlineRasterizer {
  public:
   FlatRasterizer() noexcept;
@@ -100,22 +183,94 @@ class FlatRasterizer : public ScanlineRasterizer {
   Direction light_direction_;
 };
 
-class TexturedRasterizer : public ScanlineRasterizer {
+// Diagnostic view of the scanline walk that colors every pixel by how many
+// fragments were written to it or depth tested at it, from blue for one to
+// white for kHeatmapLevels or more. Uncovered pixels stay black.
+class OverdrawRasterizer : public ScanlineRasterizer {
  public:
-  TexturedRasterizer() noexcept;
+  OverdrawRasterizer() noexcept;
+  OverdrawRasterizer(HeatmapMetric metric) noexcept;
+  virtual void RasterizeSpace(const Space& space,
+                              UserInterface& user_interface) noexcept override;
 
  private:
+  virtual void RasterizeTriangle(const Space& space,
+                                 size_t triangle_index,
+                                 const ScreenRectangle& scissor) noexcept
+      override;
   virtual void RasterizeTriangleHalf(PixelCoordinates& pc,
                                      OrderedVertexIndices& vi,
-                                     const TriangleSharedPointer& triangle,
                                      TriangleHalf triangle_half,
-                                     uint8_t color_value) noexcept override;
+                                     uint8_t color_value,
+                                     const ScreenRectangle& scissor,
+                                     float nearest_z) noexcept override;
+  virtual void Resize(uint16_t width, uint16_t height) override;
+  void WriteHeatmap() noexcept;
+
+  HeatmapMetric metric_;
+  AlignedBuffer<uint16_t> fragment_writes_;
+  AlignedBuffer<uint16_t> depth_tests_;
+};
+
+class TexturedRasterizer : public ScanlineRasterizer {
+ public:
+  TexturedRasterizer() noexcept;
+
+ protected:
+  virtual void RasterizeTriangle(const Space& space,
+                                 size_t triangle_index,
+                                 const ScreenRectangle& scissor) noexcept
+      override;
+  bool SetUpTriangle(TriangleSetup& setup,
+                     const Space& space,
+                     size_t triangle_index) const noexcept;
+  void RasterizeSetUpTriangle(const TriangleSetup& setup,
+                              const ScreenRectangle& scissor) noexcept;
+
+  Texture texture_;
+
+ private:
+  bool SetPerspectiveGradients(
+      PerspectiveGradients& gradients,
+      const PixelCoordinates& pc,
+      const OrderedVertexIndices& vi,
+      const UVMatrixView& uv_coordinates) const noexcept;
+  void RasterizeTexturedHalf(PixelCoordinates& pc,
+                             OrderedVertexIndices& vi,
+                             TriangleHalf triangle_half,
+                             const PerspectiveGradients& gradients,
+                             const ScreenRectangle& scissor,
+                             float nearest_z) noexcept;
   void WritePixel(const ScanlineParameters& sp,
                   uint8_t* pixels,
                   int pitch,
                   const Vector2& uv) noexcept;
+};
 
-  Texture texture_;
+// Sets up the output triangles and bins them into screen tiles, then
+// rasterizes the tiles in parallel on a job system, the shared one by
+// default. Tiles never overlap, so each job owns the color and depth memory
+// of the tile it is processing.
+class TiledRasterizer : public TexturedRasterizer {
+ public:
+  TiledRasterizer() noexcept;
+  TiledRasterizer(JobSystem& job_system) noexcept;
+  virtual void RasterizeSpace(const Space& space,
+                              UserInterface& user_interface) noexcept override;
+
+ private:
+  virtual void Resize(uint16_t width, uint16_t height) override;
+  void SetUpTriangles(const Space& space) noexcept;
+  void BinTriangles(const Space& space) noexcept;
+  void RasterizeTile(size_t tile_index) noexcept;
+  ScreenRectangle GetTileRectangle(size_t tile_index) const noexcept;
+
+  size_t tile_columns_;
+  std::vector<std::vector<uint32_t>> tile_bins_;
+  // One entry per output triangle; degenerate triangles are not binned
+  std::vector<TriangleSetup> triangle_setups_;
+  std::vector<uint8_t> triangle_degenerate_;
+  JobSystem& job_system_;
 };
 
 #endif
\ No newline at end of file
@@ -14,7 +14,18 @@ void SetColor(SDL_Renderer* renderer, const SDL_Color color) noexcept {
 UserInterface::UserInterface() : UserInterface(true) {}
 
 UserInterface::UserInterface(bool initialize_sdl_objects)
-    : sdl_objects_initialized_(false) {
+    : UserInterface(kDefaultWindowWidth,
+                    kDefaultWindowHeight,
+                    initialize_sdl_objects) {}
+
+UserInterface::UserInterface(uint16_t width,
+                             uint16_t height,
+                             bool initialize_sdl_objects)
+    : width_(width),
+      height_(height),
+      render_width_(width),
+      render_height_(height),
+      sdl_objects_initialized_(false) {
   if (initialize_sdl_objects)
     InitializeSdlObjects();
 }
@@ -86,13 +97,31 @@ uint16_t UserInterface::GetHeight() const noexcept {
   return height_;
 }
 
+// Frames are rasterized into the top left render_width_ x render_height_
+// pixels of the window sized texture and stretched over the window on
+// present, so that the render size can change without recreating the texture
+void UserInterface::SetRenderSize(uint16_t width, uint16_t height) noexcept {
+  assert(width && width <= width_ && height && height <= height_);
+  render_width_ = width;
+  render_height_ = height;
+}
+
+uint16_t UserInterface::GetRenderWidth() const noexcept {
+  return render_width_;
+}
+
+uint16_t UserInterface::GetRenderHeight() const noexcept {
+  return render_height_;
+}
+
 void UserInterface::StartFrameRasterization(uint8_t** pixels,
                                             int* pitch) noexcept {
   SDL_LockTexture(sdl_texture_, NULL, reinterpret_cast<void**>(pixels), pitch);
 }
 
 void UserInterface::EndFrameRasterization() const noexcept {
-  SDL_RenderCopy(sdl_renderer_, sdl_texture_, NULL, NULL);
+  SDL_Rect source = {0, 0, render_width_, render_height_};
+  SDL_RenderCopy(sdl_renderer_, sdl_texture_, &source, NULL);
   SDL_UnlockTexture(sdl_texture_);
 }
 
@@ -108,16 +137,25 @@ void UserInterface::RenderPresent() const noexcept {
   SDL_RenderPresent(sdl_renderer_);
 }
 
+// Lines are given in render coordinates and drawn straight to the window
 void UserInterface::DrawLine(int x1, int y1, int x2, int y2) const noexcept {
-  SDL_RenderDrawLine(sdl_renderer_, x1, y1, x2, y2);
+  SDL_RenderDrawLine(sdl_renderer_, x1 * width_ / render_width_,
+                     y1 * height_ / render_height_, x2 * width_ / render_width_,
+                     y2 * height_ / render_height_);
 }
 
-BenchmarkInterface::BenchmarkInterface() noexcept
-    : UserInterface(false), pitch_(kWindowWidth * kBytesPerPixel) {}
+BenchmarkInterface::BenchmarkInterface()
+    : BenchmarkInterface(kDefaultWindowWidth, kDefaultWindowHeight) {}
+
+// Rows are padded to whole cache lines, like the depth buffer rows
+BenchmarkInterface::BenchmarkInterface(uint16_t width, uint16_t height)
+    : UserInterface(width, height, false),
+      pitch_(::GetCacheLinePaddedCount<uint8_t>(width * kBytesPerPixel)),
+      pixels_(pitch_ * height) {}
 
 void BenchmarkInterface::StartFrameRasterization(uint8_t** pixels,
                                                  int* pitch) noexcept {
-  *pixels = pixels_;
+  *pixels = pixels_.data();
   *pitch = pitch_;
 }
 
@@ -5,16 +5,21 @@
 #include <cstdint>
 
 #include "server/game_state.hpp"
+#include "utility/aligned_buffer.hpp"
 
 class UserInterface {
  public:
   UserInterface();
   UserInterface(bool initialize_sdl_objects);
+  UserInterface(uint16_t width, uint16_t height, bool initialize_sdl_objects);
   ~UserInterface();
   UserInterface(const UserInterface&) = delete;
   UserInterface& operator=(UserInterface&) = delete;
   uint16_t GetWidth() const noexcept;
   uint16_t GetHeight() const noexcept;
+  void SetRenderSize(uint16_t width, uint16_t height) noexcept;
+  uint16_t GetRenderWidth() const noexcept;
+  uint16_t GetRenderHeight() const noexcept;
   virtual void StartFrameRasterization(uint8_t** pixels, int* pitch) noexcept;
   virtual void EndFrameRasterization() const noexcept;
   virtual void ClearWithBackgroundColor() const noexcept;
@@ -22,8 +27,10 @@ class UserInterface {
   virtual void DrawLine(int x1, int y1, int x2, int y2) const noexcept;
 
  protected:
-  const uint16_t width_ = kWindowWidth;
-  const uint16_t height_ = kWindowHeight;
+  const uint16_t width_;
+  const uint16_t height_;
+  uint16_t render_width_;
+  uint16_t render_height_;
 
  private:
   bool InitializeSdlObjects();
@@ -36,7 +43,8 @@ class UserInterface {
 
 class BenchmarkInterface : public UserInterface {
  public:
-  BenchmarkInterface() noexcept;
+  BenchmarkInterface();
+  BenchmarkInterface(uint16_t width, uint16_t height);
   virtual void StartFrameRasterization(uint8_t** pixels,
                                        int* pitch) noexcept override;
   virtual void EndFrameRasterization() const noexcept override;
@@ -45,8 +53,8 @@ class BenchmarkInterface : public UserInterface {
   virtual void DrawLine(int x1, int y1, int x2, int y2) const noexcept override;
 
  private:
-  uint8_t pixels_[kWindowWidth * kWindowHeight * kBytesPerPixel];
   int pitch_;
+  AlignedBuffer<uint8_t> pixels_;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+#include "ui/z_buffer.hpp"
+#include "utility/simd.hpp"
+
+namespace {
+bool IsBehind(float nearest_z, float max_depth) noexcept {
+  return !(nearest_z - kDepthBias < max_depth);
+}
+}  // namespace
+
+HierarchicalZBuffer::HierarchicalZBuffer()
+    : HierarchicalZBuffer(kDefaultWindowWidth, kDefaultWindowHeight) {}
+
+HierarchicalZBuffer::HierarchicalZBuffer(uint16_t width, uint16_t height)
+    : width_(0), height_(0), row_stride_(0), tile_columns_(0) {
+  Resize(width, height);
+}
+
+// Reallocates and clears the buffers if the size changed
+void HierarchicalZBuffer::Resize(uint16_t width, uint16_t height) {
+  if (width == width_ && height == height_)
+    return;
+  width_ = width;
+  height_ = height;
+  row_stride_ = ::GetCacheLinePaddedCount<float>(width);
+  tile_columns_ = (width + kCoarseDepthTileSize - 1) / kCoarseDepthTileSize;
+  size_t tile_rows = (height + kCoarseDepthTileSize - 1) / kCoarseDepthTileSize;
+  depths_ = AlignedBuffer<float>(row_stride_ * height);
+  tile_max_depths_ = AlignedBuffer<float>(tile_columns_ * tile_rows);
+  tile_dirty_ = AlignedBuffer<bool>(tile_columns_ * tile_rows);
+  tile_written_pixels_ = AlignedBuffer<uint16_t>(tile_columns_ * tile_rows);
+  Reset();
+}
+
+uint16_t HierarchicalZBuffer::GetWidth() const noexcept {
+  return width_;
+}
+
+uint16_t HierarchicalZBuffer::GetHeight() const noexcept {
+  return height_;
+}
+
+void HierarchicalZBuffer::Reset() noexcept {
+  depths_.fill(kClearDepth);
+  tile_max_depths_.fill(kClearDepth);
+  tile_dirty_.fill(false);
+  tile_written_pixels_.fill(0);
+}
+
+// The rectangle is expected to be aligned to coarse tiles
+void HierarchicalZBuffer::ResetRectangle(
+    const ScreenRectangle& rectangle) noexcept {
+  assert(rectangle.x_min % kCoarseDepthTileSize == 0);
+  assert(rectangle.y_min % kCoarseDepthTileSize == 0);
+  for (uint16_t y = rectangle.y_min; y <= rectangle.y_max; y++) {
+    float* row = GetRow(y);
+    std::fill(row + rectangle.x_min, row + rectangle.x_max + 1, kClearDepth);
+  }
+  for (uint16_t y = rectangle.y_min; y <= rectangle.y_max;
+       y += kCoarseDepthTileSize)
+    for (uint16_t x = rectangle.x_min; x <= rectangle.x_max;
+         x += kCoarseDepthTileSize) {
+      tile_max_depths_[GetTileIndex(x, y)] = kClearDepth;
+      tile_dirty_[GetTileIndex(x, y)] = false;
+      tile_written_pixels_[GetTileIndex(x, y)] = 0;
+    }
+}
+
+// Pixels written since the last reset, counted per coarse tile as their
+// cleared depth is replaced, so that only the tile counts are summed here.
+// Pixels written exactly at the far plane count again on their next write.
+size_t HierarchicalZBuffer::CountWrittenPixels() const noexcept {
+  return std::accumulate(tile_written_pixels_.begin(),
+                         tile_written_pixels_.end(), size_t{0});
+}
+
+// Conservative: true only if no depth test in the rectangle can pass for a
+// primitive whose depth is at least nearest_z
+bool HierarchicalZBuffer::IsRectangleOccluded(const ScreenRectangle& rectangle,
+                                              float nearest_z) noexcept {
+  size_t first_column = rectangle.x_min / kCoarseDepthTileSize;
+  size_t last_column = rectangle.x_max / kCoarseDepthTileSize;
+  size_t first_row = rectangle.y_min / kCoarseDepthTileSize;
+  size_t last_row = rectangle.y_max / kCoarseDepthTileSize;
+  for (size_t row = first_row; row <= last_row; row++)
+    for (size_t column = first_column; column <= last_column; column++) {
+      size_t tile = row * tile_columns_ + column;
+      if (::IsBehind(nearest_z, tile_max_depths_[tile]))
+        continue;
+      if (!tile_dirty_[tile])
+        return false;
+      UpdateTileMaxDepth(column, row);
+      if (!::IsBehind(nearest_z, tile_max_depths_[tile]))
+        return false;
+    }
+  return true;
+}
+
+bool HierarchicalZBuffer::IsTileOccluded(uint16_t x,
+                                         uint16_t y,
+                                         float nearest_z) const noexcept {
+  return ::IsBehind(nearest_z, tile_max_depths_[GetTileIndex(x, y)]);
+}
+
+// Shrinks an inclusive span, walked in the direction of the increment, past
+// the occluded coarse tiles at both of its ends. Returns false if nothing
+// remains.
+bool HierarchicalZBuffer::TrimOccludedSpan(uint16_t& first_x,
+                                           uint16_t& last_x,
+                                           int8_t increment,
+                                           uint16_t y,
+                                           float nearest_z) const noexcept {
+  int first = first_x;
+  int last = last_x;
+  auto tile_start = [](int x) {
+    return x - x % kCoarseDepthTileSize;
+  };
+  auto tile_end = [](int x) {
+    return x - x % kCoarseDepthTileSize + kCoarseDepthTileSize - 1;
+  };
+  while ((last - first) * increment >= 0 &&
+         IsTileOccluded(first, y, nearest_z))
+    first = increment > 0 ? tile_end(first) + 1 : tile_start(first) - 1;
+  while ((last - first) * increment >= 0 && IsTileOccluded(last, y, nearest_z))
+    last = increment > 0 ? tile_start(last) - 1 : tile_end(last) + 1;
+  if ((last - first) * increment < 0)
+    return false;
+  first_x = first;
+  last_x = last;
+  return true;
+}
+
+void HierarchicalZBuffer::UpdateTileMaxDepth(size_t tile_column,
+                                             size_t tile_row) noexcept {
+  size_t x_min = tile_column * kCoarseDepthTileSize;
+  size_t y_min = tile_row * kCoarseDepthTileSize;
+  size_t x_end = std::min<size_t>(x_min + kCoarseDepthTileSize, width_);
+  size_t y_end = std::min<size_t>(y_min + kCoarseDepthTileSize, height_);
+  float max_depth = -kClearDepth;
+  for (size_t y = y_min; y < y_end; y++) {
+    const float* row = depths_.data() + y * row_stride_;
+    size_t x = x_min;
+    if (x_end - x_min == kCoarseDepthTileSize) {
+      FloatBlock block_max = SimdLoad(row + x);
+      for (x += kSimdWidth; x < x_end; x += kSimdWidth)
+        block_max = SimdMax(block_max, SimdLoad(row + x));
+      alignas(32) float lanes[kSimdWidth];
+      SimdStore(lanes, block_max);
+      max_depth =
+          std::max(max_depth, *std::max_element(lanes, lanes + kSimdWidth));
+    } else {
+      for (; x < x_end; x++)
+        max_depth = std::max(max_depth, row[x]);
+    }
+  }
+  size_t tile = tile_row * tile_columns_ + tile_column;
+  tile_max_depths_[tile] = max_depth;
+  tile_dirty_[tile] = false;
+}
@@ -0,0 +1,91 @@
+#ifndef Z_BUFFER_HPP
+#define Z_BUFFER_HPP
+
+#include "geometry/common.hpp"
+#include "utility/aligned_buffer.hpp"
+
+typedef struct ScreenRectangle {
+  uint16_t x_min;
+  uint16_t y_min;
+  uint16_t x_max;
+  uint16_t y_max;
+} ScreenRectangle;
+
+// Two-level depth buffer. Besides the per-pixel depths it keeps, for each
+// coarse tile, an upper bound of the depths stored in it. The bound is
+// tightened lazily, only when a query cannot be answered with the stale one,
+// and a count of the pixels written since the last reset.
+// Rows are padded to whole cache lines.
+class HierarchicalZBuffer {
+ public:
+  HierarchicalZBuffer();
+  HierarchicalZBuffer(uint16_t width, uint16_t height);
+  void Resize(uint16_t width, uint16_t height);
+  uint16_t GetWidth() const noexcept;
+  uint16_t GetHeight() const noexcept;
+  void Reset() noexcept;
+  void ResetRectangle(const ScreenRectangle& rectangle) noexcept;
+  bool CheckAndReplace(float new_value, uint16_t x, uint16_t y) noexcept;
+  float* GetRow(uint16_t y) noexcept;
+  void MarkWritten(uint16_t x, uint16_t y, uint16_t newly_written) noexcept;
+  bool IsRectangleOccluded(const ScreenRectangle& rectangle,
+                           float nearest_z) noexcept;
+  bool IsTileOccluded(uint16_t x, uint16_t y, float nearest_z) const noexcept;
+  size_t CountWrittenPixels() const noexcept;
+  bool TrimOccludedSpan(uint16_t& first_x,
+                        uint16_t& last_x,
+                        int8_t increment,
+                        uint16_t y,
+                        float nearest_z) const noexcept;
+
+ private:
+  size_t GetTileIndex(uint16_t x, uint16_t y) const noexcept;
+  void UpdateTileMaxDepth(size_t tile_column, size_t tile_row) noexcept;
+
+  uint16_t width_;
+  uint16_t height_;
+  size_t row_stride_;
+  size_t tile_columns_;
+  AlignedBuffer<float> depths_;
+  AlignedBuffer<float> tile_max_depths_;
+  AlignedBuffer<bool> tile_dirty_;
+  AlignedBuffer<uint16_t> tile_written_pixels_;
+};
+
+// The per-pixel accessors are inline, so that the buffer pointers and the
+// row stride stay in registers across a span like the former constants did
+inline bool HierarchicalZBuffer::CheckAndReplace(float new_value,
+                                                 uint16_t x,
+                                                 uint16_t y) noexcept {
+  float& depth = depths_[y * row_stride_ + x];
+  if (new_value - kDepthBias < depth) {
+    size_t tile = GetTileIndex(x, y);
+    tile_written_pixels_[tile] += depth == kClearDepth;
+    depth = new_value;
+    tile_dirty_[tile] = true;
+    return true;
+  }
+  return false;
+}
+
+inline float* HierarchicalZBuffer::GetRow(uint16_t y) noexcept {
+  return depths_.data() + y * row_stride_;
+}
+
+// For kernels that store depths through GetRow. Of the pixels written in the
+// tile, newly_written are those that still had the cleared depth.
+inline void HierarchicalZBuffer::MarkWritten(uint16_t x,
+                                             uint16_t y,
+                                             uint16_t newly_written) noexcept {
+  size_t tile = GetTileIndex(x, y);
+  tile_dirty_[tile] = true;
+  tile_written_pixels_[tile] += newly_written;
+}
+
+inline size_t HierarchicalZBuffer::GetTileIndex(uint16_t x,
+                                                uint16_t y) const noexcept {
+  return (y / kCoarseDepthTileSize) * tile_columns_ +
+         x / kCoarseDepthTileSize;
+}
+
+#endif
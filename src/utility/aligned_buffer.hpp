@@ -0,0 +1,60 @@
+#ifndef ALIGNED_BUFFER_HPP
+#define ALIGNED_BUFFER_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "geometry/common.hpp"
+
+// Fixed-size heap array of trivial elements starting on a cache line. Frame
+// buffers sized at run time use it in place of std::array, so that rows
+// padded to whole cache lines start on a line boundary as well.
+template <typename T>
+class AlignedBuffer {
+  static_assert(std::is_trivial<T>::value, "elements are not constructed");
+
+ public:
+  AlignedBuffer() noexcept = default;
+  explicit AlignedBuffer(size_t size);
+  T* data() noexcept { return data_.get(); }
+  const T* data() const noexcept { return data_.get(); }
+  size_t size() const noexcept { return size_; }
+  T* begin() noexcept { return data(); }
+  T* end() noexcept { return data() + size_; }
+  const T* begin() const noexcept { return data(); }
+  const T* end() const noexcept { return data() + size_; }
+  T& operator[](size_t index) noexcept { return data_[index]; }
+  const T& operator[](size_t index) const noexcept { return data_[index]; }
+  void fill(const T& value) noexcept { std::fill(begin(), end(), value); }
+
+ private:
+  struct FreeDeleter {
+    void operator()(T* pointer) const noexcept { std::free(pointer); }
+  };
+
+  std::unique_ptr<T[], FreeDeleter> data_;
+  size_t size_ = 0;
+};
+
+// Rounds count up to a whole number of cache lines worth of T
+template <typename T>
+constexpr size_t GetCacheLinePaddedCount(size_t count) noexcept {
+  constexpr size_t kPerLine = kCacheLineSize / sizeof(T);
+  return (count + kPerLine - 1) / kPerLine * kPerLine;
+}
+
+// std::aligned_alloc wants a size that is a multiple of the alignment
+template <typename T>
+AlignedBuffer<T>::AlignedBuffer(size_t size) : size_(size) {
+  if (!size)
+    return;
+  size_t bytes = ::GetCacheLinePaddedCount<uint8_t>(size * sizeof(T));
+  data_.reset(static_cast<T*>(std::aligned_alloc(kCacheLineSize, bytes)));
+  if (!data_)
+    throw std::bad_alloc();
+}
+
+#endif
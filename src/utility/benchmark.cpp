@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "utility/benchmark.hpp"
+
+namespace {
+float Interpolate(float from, float to, float t) noexcept {
+  return from + t * (to - from);
+}
+
+// The strings are file and rasterizer names, so escaping quotes and
+// backslashes is enough
+void WriteJsonString(std::ostream& output_stream, const std::string& value) {
+  output_stream << '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\')
+      output_stream << '\\';
+    output_stream << c;
+  }
+  output_stream << '"';
+}
+
+void WriteDistribution(std::ostream& output_stream,
+                       const char* name,
+                       const std::vector<float>& values) {
+  float sum = 0;
+  for (float value : values)
+    sum += value;
+  float mean = values.empty() ? 0 : sum / values.size();
+  output_stream << "    \"" << name << "\": {\"mean\": " << mean
+                << ", \"min\": " << ::GetPercentile(values, 0)
+                << ", \"p50\": " << ::GetPercentile(values, 50)
+                << ", \"p95\": " << ::GetPercentile(values, 95)
+                << ", \"p99\": " << ::GetPercentile(values, 99)
+                << ", \"max\": " << ::GetPercentile(values, 100) << "}";
+}
+}  // namespace
+
+CameraPathException::CameraPathException(const char* error_message)
+    : error_message_(error_message) {}
+
+const char* CameraPathException::what() const noexcept {
+  return error_message_;
+}
+
+void CameraPath::LoadFromFile(const char* filename) {
+  std::ifstream input_file_stream(filename);
+  if (!input_file_stream)
+    throw CameraPathException("Camera path could not be opened!");
+  LoadFromInputStream(input_file_stream);
+}
+
+void CameraPath::LoadFromInputStream(std::istream& input_stream) {
+  keyframes_.clear();
+  std::string line;
+  while (std::getline(input_stream, line)) {
+    std::stringstream ss(line);
+    ss >> std::ws;
+    if (ss.eof() || ss.peek() == '#')
+      continue;
+    size_t frame;
+    float x, y, z, pitch, yaw, roll;
+    if (!(ss >> frame >> x >> y >> z >> pitch >> yaw >> roll))
+      throw CameraPathException("Keyframe must have seven parameters!");
+    if (!(ss >> std::ws).eof())
+      throw CameraPathException("Keyframe has more than seven parameters!");
+    if (keyframes_.empty() ? frame != 0 : frame <= keyframes_.back().frame)
+      throw CameraPathException("Keyframes must start at zero and increase!");
+    keyframes_.push_back({frame, Camera({x, y, z}, pitch, yaw, roll)});
+  }
+  if (keyframes_.empty())
+    throw CameraPathException("Camera path has no keyframes!");
+}
+
+size_t CameraPath::GetFrameCount() const noexcept {
+  return keyframes_.empty() ? 0 : keyframes_.back().frame + 1;
+}
+
+Camera CameraPath::GetCamera(size_t frame) const noexcept {
+  assert(!keyframes_.empty());
+  auto next = std::upper_bound(
+      keyframes_.begin(), keyframes_.end(), frame,
+      [](size_t f, const CameraKeyframe& keyframe) {
+        return f < keyframe.frame;
+      });
+  if (next == keyframes_.end())
+    return keyframes_.back().camera;
+  const CameraKeyframe& previous = *(next - 1);
+  float t = static_cast<float>(frame - previous.frame) /
+            (next->frame - previous.frame);
+  const Camera& from = previous.camera;
+  const Camera& to = next->camera;
+  Vector4 location = from.GetLocation().GetVector() +
+                     t * (to.GetLocation().GetVector() -
+                          from.GetLocation().GetVector());
+  return Camera({location[kX], location[kY], location[kZ]},
+                ::Interpolate(from.GetPitch(), to.GetPitch(), t),
+                ::Interpolate(from.GetYaw(), to.GetYaw(), t),
+                ::Interpolate(from.GetRoll(), to.GetRoll(), t));
+}
+
+BenchmarkReport::BenchmarkReport(const BenchmarkSettings& settings)
+    : settings_(settings) {}
+
+void BenchmarkReport::AddFrame(const FrameTimings& timings) {
+  frames_.push_back(timings);
+}
+
+const std::vector<FrameTimings>& BenchmarkReport::GetFrames() const noexcept {
+  return frames_;
+}
+
+void BenchmarkReport::WriteJson(std::ostream& output_stream) const {
+  std::vector<float> pipeline, rasterization, total;
+  for (const FrameTimings& frame : frames_) {
+    pipeline.push_back(frame.pipeline_ms);
+    rasterization.push_back(frame.rasterization_ms);
+    total.push_back(frame.total_ms);
+  }
+  output_stream << std::setprecision(6) << "{\n  \"scene\": ";
+  ::WriteJsonString(output_stream, settings_.scene);
+  output_stream << ",\n  \"camera_path\": ";
+  ::WriteJsonString(output_stream, settings_.camera_path);
+  output_stream << ",\n  \"rasterizer\": ";
+  ::WriteJsonString(output_stream, settings_.rasterizer);
+  output_stream << ",\n  \"width\": " << settings_.width
+                << ",\n  \"height\": " << settings_.height
+                << ",\n  \"pipelined\": "
+                << (settings_.pipelined ? "true" : "false")
+                << ",\n  \"screen_space_culling\": "
+                << (settings_.screen_space_culling ? "true" : "false")
+                << ",\n  \"guard_band\": "
+                << (settings_.guard_band ? "true" : "false")
+                << ",\n  \"frame_count\": " << frames_.size()
+                << ",\n  \"summary_ms\": {\n";
+  ::WriteDistribution(output_stream, "total", total);
+  output_stream << ",\n";
+  ::WriteDistribution(output_stream, "pipeline", pipeline);
+  output_stream << ",\n";
+  ::WriteDistribution(output_stream, "rasterization", rasterization);
+  output_stream << "\n  },\n  \"frames\": [";
+  for (size_t i = 0; i < frames_.size(); i++) {
+    const FrameTimings& frame = frames_[i];
+    output_stream << (i ? ",\n" : "\n") << "    {\"frame\": " << i
+                  << ", \"triangles\": " << frame.triangle_count
+                  << ", \"total_ms\": " << frame.total_ms
+                  << ", \"pipeline_ms\": " << frame.pipeline_ms
+                  << ", \"rasterization_ms\": " << frame.rasterization_ms;
+    const PipelineStatistics& geometry = frame.pipeline_statistics;
+    output_stream << ", \"input_triangles\": " << geometry.input_triangles
+                  << ", \"frustum_culled\": " << geometry.frustum_culled
+                  << ", \"back_face_culled\": " << geometry.back_face_culled
+                  << ", \"screen_culled\": " << geometry.screen_culled
+                  << ", \"trivially_rejected\": "
+                  << geometry.trivially_rejected
+                  << ", \"clipped\": " << geometry.clipped
+                  << ", \"produced_by_clipping\": "
+                  << geometry.produced_by_clipping;
+    const RasterizerStatistics& fragments = frame.rasterizer_statistics;
+    output_stream << ", \"depth_tested\": " << fragments.depth_tested
+                  << ", \"depth_passed\": " << fragments.depth_passed
+                  << ", \"pixels_covered\": " << fragments.pixels_covered
+                  << ", \"overdraw_ratio\": " << fragments.overdraw_ratio
+                  << "}";
+  }
+  output_stream << "\n  ]\n}\n";
+}
+
+float GetPercentile(std::vector<float> values, float percentile) {
+  if (values.empty())
+    return 0;
+  size_t rank = std::ceil(percentile / 100 * values.size());
+  size_t index = rank ? rank - 1 : 0;
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
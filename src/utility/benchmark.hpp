@@ -0,0 +1,78 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "geometry/camera.hpp"
+
+class CameraPathException : public std::exception {
+ public:
+  CameraPathException(const char* error_message);
+  virtual const char* what() const noexcept override;
+
+ private:
+  const char* error_message_;
+};
+
+typedef struct CameraKeyframe {
+  size_t frame;
+  Camera camera;
+} CameraKeyframe;
+
+// Scripted camera movement read from a text file with one keyframe per line:
+//   <frame> <x> <y> <z> <pitch> <yaw> <roll>
+// Frames must be strictly increasing and the first one must be zero. The
+// camera is interpolated linearly between keyframes. Lines starting with '#'
+// are comments.
+class CameraPath {
+ public:
+  void LoadFromFile(const char* filename);
+  void LoadFromInputStream(std::istream& input_stream);
+  size_t GetFrameCount() const noexcept;
+  Camera GetCamera(size_t frame) const noexcept;
+
+ private:
+  std::vector<CameraKeyframe> keyframes_;
+};
+
+typedef struct FrameTimings {
+  float pipeline_ms;
+  float rasterization_ms;
+  float total_ms;
+  size_t triangle_count;
+  PipelineStatistics pipeline_statistics;
+  RasterizerStatistics rasterizer_statistics;
+} FrameTimings;
+
+typedef struct BenchmarkSettings {
+  std::string scene;
+  std::string camera_path;
+  std::string rasterizer;
+  uint16_t width;
+  uint16_t height;
+  bool pipelined;
+  bool screen_space_culling;
+  bool guard_band;
+} BenchmarkSettings;
+
+// Collects the timings of a headless run and writes them as JSON, together
+// with the distribution of every stage.
+class BenchmarkReport {
+ public:
+  BenchmarkReport(const BenchmarkSettings& settings);
+  void AddFrame(const FrameTimings& timings);
+  const std::vector<FrameTimings>& GetFrames() const noexcept;
+  void WriteJson(std::ostream& output_stream) const;
+
+ private:
+  BenchmarkSettings settings_;
+  std::vector<FrameTimings> frames_;
+};
+
+// Nearest-rank percentile in [0, 100]; zero for an empty sample
+float GetPercentile(std::vector<float> values, float percentile);
+
+#endif
@@ -45,8 +45,17 @@ UnsupportedPrimitiveException::UnsupportedPrimitiveException(
     const char* error_message)
     : GeometryImportException(error_message) {}
 
-GeometryImporter::GeometryImporter(Space& space)
-    : space_(space), triangle_counter_(0), vertex_counter_(0), uv_counter_(0) {}
+// The caps bound the vertices and UV coordinates read as well as the
+// triangles; the buffers only grow as far as the file needs
+GeometryImporter::GeometryImporter(Mesh& mesh,
+                                   size_t max_vertices,
+                                   size_t max_triangles)
+    : mesh_(mesh),
+      max_vertices_(max_vertices),
+      max_triangles_(max_triangles),
+      triangle_counter_(0),
+      vertex_counter_(0),
+      uv_counter_(0) {}
 
 void GeometryImporter::ImportGeometryFromFile(const char* filename) {
   std::ifstream input_file_stream;
@@ -67,15 +76,17 @@ size_t GeometryImporter::GetVertexCount() const noexcept {
   return vertex_counter_;
 }
 
-ObjGeometryImporter::ObjGeometryImporter(Space& space)
-    : GeometryImporter(space) {}
+ObjGeometryImporter::ObjGeometryImporter(Mesh& mesh,
+                                         size_t max_vertices,
+                                         size_t max_triangles)
+    : GeometryImporter(mesh, max_vertices, max_triangles) {}
 
 void ObjGeometryImporter::ImportGeometryFromInputStream(
     std::istream& input_stream) {
   std::string line;
   while (std::getline(input_stream, line))
     ParseLine(line);
-  space_.UpdateSpace();
+  mesh_.UpdateMesh();
 }
 
 void ObjGeometryImporter::ParseLine(const std::string& line) {
@@ -94,6 +105,10 @@ void ObjGeometryImporter::ParseLine(const std::string& line) {
     } else if (word == "vt") {
       ParseUVCoordinate(ss);
       return;
+    } else if (word == "o" || word == "g") {
+      // Objects and groups are culled as a whole; their names are not kept
+      mesh_.BeginObject();
+      return;
     } else
       throw UnknownCommandException("Unknown command!");
   }
@@ -101,7 +116,7 @@ void ObjGeometryImporter::ParseLine(const std::string& line) {
 
 void ObjGeometryImporter::ParseVertex(std::stringstream& vertex_params) {
   std::array<float, kDimensions> read_value;
-  if (vertex_counter_ == kMaxVertices)
+  if (vertex_counter_ == max_vertices_)
     throw WorldLimitsExceededException("Number of maximum vertices exceeded!");
   for (size_t dim = 0; dim < kSpatialDimensions; dim++) {
     if (!::MoreWordsRemaining(vertex_params))
@@ -116,14 +131,15 @@ void ObjGeometryImporter::ParseVertex(std::stringstream& vertex_params) {
   if (::MoreWordsRemaining(vertex_params))
     throw MalformedParametersException(
         "Vertex contained more than four coordinates!");
-  vertices_[vertex_counter_++] =
-      Vector4(read_value[0], read_value[1], read_value[2], read_value[3]);
+  vertices_.push_back(
+      Vector4(read_value[0], read_value[1], read_value[2], read_value[3]));
+  vertex_counter_++;
 }
 
 void ObjGeometryImporter::ParseFace(std::stringstream& face_params) {
   std::array<size_t, kVerticesPerTriangle> vertex_indices;
   std::array<size_t, kVerticesPerTriangle> uv_indices = {0};
-  if (triangle_counter_ == kMaxTriangles)
+  if (triangle_counter_ == max_triangles_)
     throw WorldLimitsExceededException("Number of maximum triangles exceeded!");
   for (size_t i = 0; i < kVerticesPerTriangle; i++) {
     if (::MoreWordsRemaining(face_params)) {
@@ -147,23 +163,32 @@ void ObjGeometryImporter::ParseFace(std::stringstream& face_params) {
 
   ::RearrangeIndicesByWindingDirection(vertex_indices.data());
   ::RearrangeIndicesByWindingDirection(uv_indices.data());
-  std::array<Vertex, kVerticesPerTriangle> uv_vertices;
-  for (size_t i = 0; i < kVerticesPerTriangle; i++) {
-    if (uv_indices[i])
-      uv_vertices[i] = Vertex(vertices_[vertex_indices[i] - 1],
-                              uv_coordinates_[uv_indices[i] - 1]);
-    else
-      uv_vertices[i] = vertices_[vertex_indices[i] - 1];
-  }
-  TriangleSharedPointer triangle = std::make_shared<Triangle>(
-      uv_vertices[0], uv_vertices[1], uv_vertices[2]);
-  space_.EnqueueAddTriangle(triangle);
+  std::array<uint32_t, kVerticesPerTriangle> mesh_indices;
+  for (size_t i = 0; i < kVerticesPerTriangle; i++)
+    mesh_indices[i] = GetMeshVertexIndex(vertex_indices[i], uv_indices[i]);
+  mesh_.EnqueueAddTriangle(mesh_indices[0], mesh_indices[1], mesh_indices[2]);
   triangle_counter_++;
 }
 
+// Each distinct pair of OBJ position and UV indices becomes one mesh vertex;
+// a UV index of zero means that the face has no UV coordinates
+uint32_t ObjGeometryImporter::GetMeshVertexIndex(size_t vertex_index,
+                                                 size_t uv_index) {
+  uint64_t key = static_cast<uint64_t>(vertex_index) << 32 | uv_index;
+  auto it = mesh_vertex_indices_.find(key);
+  if (it != mesh_vertex_indices_.end())
+    return it->second;
+  Vertex vertex = vertices_[vertex_index - 1];
+  if (uv_index)
+    vertex = Vertex(vertex, uv_coordinates_[uv_index - 1]);
+  uint32_t mesh_index = mesh_.EnqueueAddVertex(vertex);
+  mesh_vertex_indices_.emplace(key, mesh_index);
+  return mesh_index;
+}
+
 void ObjGeometryImporter::ParseUVCoordinate(std::stringstream& uv_params) {
   std::array<float, kVerticesPerTriangle> read_value;
-  if (uv_counter_ == kMaxVertices)
+  if (uv_counter_ == max_vertices_)
     throw WorldLimitsExceededException("Number of UV coordinates exceeded!");
   for (size_t dim = 0; dim < kUVDimensions; dim++) {
     uv_params >> std::ws;
@@ -176,5 +201,6 @@ void ObjGeometryImporter::ParseUVCoordinate(std::stringstream& uv_params) {
   if (!uv_params.eof())
     throw MalformedParametersException(
         "UV coordinates contained more than two coordinates!");
-  uv_coordinates_[uv_counter_++] = UVCoordinate(read_value[0], read_value[1]);
+  uv_coordinates_.push_back(UVCoordinate(read_value[0], read_value[1]));
+  uv_counter_++;
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #ifndef GEOMETRY_IMPORTER_HPP
 #define GEOMETRY_IMPORTER_HPP
 
-#include "geometry/space.hpp"
+#include <unordered_map>
+
+#include "geometry/mesh.hpp"
 
 class GeometryImportException : public std::exception {
  public:
@@ -39,16 +41,21 @@ class UnsupportedPrimitiveException : public GeometryImportException {
 
 class GeometryImporter {
  public:
-  GeometryImporter(Space& space);
+  GeometryImporter(Mesh& mesh,
+                   size_t max_vertices = kMaxVertices,
+                   size_t max_triangles = kMaxTriangles);
   void ImportGeometryFromFile(const char* filename);
   virtual void ImportGeometryFromInputStream(std::istream& input_stream) = 0;
   size_t GetTriangleCount() const noexcept;
   size_t GetVertexCount() const noexcept;
 
  protected:
-  std::array<Vertex, kMaxVertices> vertices_;
-  std::array<UVCoordinate, kMaxVertices> uv_coordinates_;
-  Space& space_;
+  std::vector<Vertex> vertices_;
+  std::vector<UVCoordinate> uv_coordinates_;
+  Mesh& mesh_;
+  size_t max_vertices_;
+  size_t max_triangles_;
+  std::unordered_map<uint64_t, uint32_t> mesh_vertex_indices_;
   size_t triangle_counter_;
   size_t vertex_counter_;
   size_t uv_counter_;
@@ -56,7 +63,9 @@ class GeometryImporter {
 
 class ObjGeometryImporter : public GeometryImporter {
  public:
-  ObjGeometryImporter(Space& space);
+  ObjGeometryImporter(Mesh& mesh,
+                      size_t max_vertices = kMaxVertices,
+                      size_t max_triangles = kMaxTriangles);
   virtual void ImportGeometryFromInputStream(
       std::istream& input_stream) override;
 
@@ -64,6 +73,7 @@ class ObjGeometryImporter : public GeometryImporter {
   void ParseLine(const std::string& line);
   void ParseVertex(std::stringstream& vertex_params);
   void ParseFace(std::stringstream& face_params);
+  uint32_t GetMeshVertexIndex(size_t vertex_index, size_t uv_index);
   void ParseUVCoordinate(std::stringstream& uv_params);
 };
 
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cassert>
+
+#include "job_system.hpp"
+
+namespace {
+// Identifies the worker threads of a system; other threads use queue zero
+thread_local const JobSystem* worker_job_system = nullptr;
+thread_local size_t worker_queue_index = 0;
+}  // namespace
+
+JobCounter::JobCounter() noexcept : pending_jobs_(0) {}
+
+bool JobCounter::IsDone() const noexcept {
+  return pending_jobs_.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem()
+    : JobSystem(std::max(1u, std::thread::hardware_concurrency())) {}
+
+// The threads that wait for jobs run them as well, hence one worker less
+JobSystem::JobSystem(size_t thread_count) : queued_jobs_(0), stop_(false) {
+  assert(thread_count > 0);
+  for (size_t i = 0; i < thread_count; i++)
+    queues_.push_back(std::make_unique<WorkQueue>());
+  for (size_t i = 1; i < thread_count; i++)
+    workers_.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stop_ = true;
+  }
+  wake_condition_.notify_all();
+  for (std::thread& worker : workers_)
+    worker.join();
+}
+
+JobSystem& JobSystem::GetInstance() {
+  static JobSystem job_system;
+  return job_system;
+}
+
+size_t JobSystem::GetThreadCount() const noexcept {
+  return workers_.size() + 1;
+}
+
+static_assert((kJobQueueCapacity & (kJobQueueCapacity - 1)) == 0,
+              "Ring indices wrap with a mask");
+
+JobSystem::WorkQueue::WorkQueue()
+    : jobs(std::make_unique<QueuedJob[]>(kJobQueueCapacity)),
+      front(0),
+      size(0) {}
+
+// Returns false, leaving the counter as it was, if the queue is full
+bool JobSystem::TryEnqueue(const QueuedJob& job, JobCounter& counter) {
+  counter.pending_jobs_.fetch_add(1, std::memory_order_relaxed);
+  WorkQueue& queue = *queues_[GetQueueIndex()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.size == kJobQueueCapacity) {
+      counter.pending_jobs_.fetch_sub(1, std::memory_order_relaxed);
+      return false;
+    }
+    QueuedJob& queued_job =
+        queue.jobs[(queue.front + queue.size) & (kJobQueueCapacity - 1)];
+    queued_job = job;
+    queued_job.counter = &counter;
+    queue.size++;
+  }
+  queued_jobs_.fetch_add(1, std::memory_order_release);
+  if (!workers_.empty()) {
+    // Pairs with the check of queued_jobs_ in WorkerLoop, so that the wake up
+    // cannot fall between the check and the wait
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+  }
+  wake_condition_.notify_one();
+  return true;
+}
+
+void JobSystem::Wait(const JobCounter& counter) {
+  size_t queue_index = GetQueueIndex();
+  while (!counter.IsDone())
+    if (!TryRunJob(queue_index))
+      std::this_thread::yield();
+}
+
+void JobSystem::WorkerLoop(size_t queue_index) {
+  ::worker_job_system = this;
+  ::worker_queue_index = queue_index;
+  while (true) {
+    if (TryRunJob(queue_index))
+      continue;
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_condition_.wait(lock, [this] {
+      return stop_ || queued_jobs_.load(std::memory_order_acquire) > 0;
+    });
+    if (stop_)
+      return;
+  }
+}
+
+size_t JobSystem::GetQueueIndex() const noexcept {
+  return ::worker_job_system == this ? ::worker_queue_index : 0;
+}
+
+// Own jobs are taken from the back, the most recent first; stolen ones from
+// the front
+bool JobSystem::TryRunJob(size_t queue_index) {
+  QueuedJob queued_job;
+  bool found = false;
+  for (size_t i = 0; i < queues_.size() && !found; i++) {
+    WorkQueue& queue = *queues_[(queue_index + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.size)
+      continue;
+    queue.size--;
+    if (i == 0) {
+      queued_job =
+          queue.jobs[(queue.front + queue.size) & (kJobQueueCapacity - 1)];
+    } else {
+      queued_job = queue.jobs[queue.front];
+      queue.front = (queue.front + 1) & (kJobQueueCapacity - 1);
+    }
+    queued_jobs_.fetch_sub(1, std::memory_order_relaxed);
+    found = true;
+  }
+  if (!found)
+    return false;
+  queued_job.function(*this, queued_job);
+  queued_job.counter->pending_jobs_.fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
+size_t TaskGraph::AddTask(Job job, const std::vector<size_t>& dependencies) {
+  size_t task_index = tasks_.size();
+  tasks_.emplace_back();
+  TaskNode& task = tasks_.back();
+  task.job = std::move(job);
+  task.dependency_count = dependencies.size();
+  for (size_t dependency : dependencies) {
+    assert(dependency < task_index);
+    tasks_[dependency].dependents.push_back(task_index);
+  }
+  return task_index;
+}
+
+void TaskGraph::Run(JobSystem& job_system) {
+  for (TaskNode& task : tasks_)
+    task.unfinished_dependencies.store(task.dependency_count,
+                                       std::memory_order_relaxed);
+  JobCounter counter;
+  for (size_t i = 0; i < tasks_.size(); i++)
+    if (!tasks_[i].dependency_count)
+      SubmitTask(i, job_system, counter);
+  job_system.Wait(counter);
+}
+
+// Dependents are submitted before the finished task is counted as done, so
+// the counter cannot reach zero while tasks remain
+void TaskGraph::SubmitTask(size_t task_index,
+                           JobSystem& job_system,
+                           JobCounter& counter) {
+  job_system.Submit(
+      [this, task_index, &job_system, &counter] {
+        TaskNode& task = tasks_[task_index];
+        task.job();
+        for (size_t dependent : task.dependents)
+          if (tasks_[dependent].unfinished_dependencies.fetch_sub(
+                  1, std::memory_order_acq_rel) == 1)
+            SubmitTask(dependent, job_system, counter);
+      },
+      counter);
+}
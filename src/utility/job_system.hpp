@@ -0,0 +1,183 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "geometry/common.hpp"
+
+typedef std::function<void()> Job;
+
+// Number of submitted jobs that have not finished yet
+class JobCounter {
+ public:
+  JobCounter() noexcept;
+  JobCounter(const JobCounter&) = delete;
+  JobCounter& operator=(const JobCounter&) = delete;
+  bool IsDone() const noexcept;
+
+ private:
+  friend class JobSystem;
+  std::atomic<size_t> pending_jobs_;
+};
+
+// Work-stealing scheduler shared by every subsystem that goes parallel, so
+// that they never run more threads than there are cores between them. Each
+// worker pushes and pops the jobs it submits at the back of its own queue and
+// steals from the front of the others', where the oldest and, for split
+// ranges, largest jobs are. Threads outside the system share one more queue.
+// Waiting threads run queued jobs instead of blocking, so jobs may submit and
+// wait for further jobs themselves.
+// Queued jobs are fixed-size records in rings allocated up front, so that
+// submitting never allocates. Submitted callables are copied into the record
+// and must therefore be small and trivially copyable, like lambdas capturing
+// by reference; ParallelFor only stores a pointer to its task.
+class JobSystem {
+ public:
+  JobSystem();
+  JobSystem(size_t thread_count);
+  ~JobSystem();
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+  static JobSystem& GetInstance();
+  size_t GetThreadCount() const noexcept;
+  template <typename Callable>
+  void Submit(const Callable& job, JobCounter& counter);
+  void Wait(const JobCounter& counter);
+  template <typename IndexedTask>
+  void ParallelFor(size_t task_count, const IndexedTask& task);
+
+ private:
+  struct QueuedJob;
+  typedef void (*JobFunction)(JobSystem& job_system, const QueuedJob& job);
+
+  // The range is only used by ParallelFor jobs
+  struct QueuedJob {
+    JobFunction function;
+    JobCounter* counter;
+    size_t begin;
+    size_t end;
+    alignas(16) unsigned char storage[kJobStorageSize];
+  };
+
+  // Double-ended ring of kJobQueueCapacity jobs
+  struct WorkQueue {
+    WorkQueue();
+    std::mutex mutex;
+    std::unique_ptr<QueuedJob[]> jobs;
+    size_t front;
+    size_t size;
+  };
+
+  void WorkerLoop(size_t queue_index);
+  size_t GetQueueIndex() const noexcept;
+  bool TryEnqueue(const QueuedJob& job, JobCounter& counter);
+  bool TryRunJob(size_t queue_index);
+  template <typename Callable>
+  static void RunCallable(JobSystem& job_system, const QueuedJob& job);
+  template <typename IndexedTask>
+  static void RunRange(JobSystem& job_system, const QueuedJob& job);
+
+  std::vector<std::unique_ptr<WorkQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> queued_jobs_;
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_condition_;
+  bool stop_;
+};
+
+// The counter has to outlive the job. If the queue is full, the job runs
+// right away on the calling thread.
+template <typename Callable>
+void JobSystem::Submit(const Callable& job, JobCounter& counter) {
+  static_assert(std::is_trivially_copyable<Callable>::value &&
+                    sizeof(Callable) <= kJobStorageSize &&
+                    alignof(Callable) <= alignof(QueuedJob),
+                "Jobs are stored in place and must be small and trivially "
+                "copyable; capture by reference");
+  QueuedJob queued_job;
+  queued_job.function = &JobSystem::RunCallable<Callable>;
+  std::memcpy(queued_job.storage, &job, sizeof(Callable));
+  if (!TryEnqueue(queued_job, counter))
+    job();
+}
+
+// Indices are handed out by splitting the range in halves, so that a thief
+// takes half of the remaining work at once
+template <typename IndexedTask>
+void JobSystem::ParallelFor(size_t task_count, const IndexedTask& task) {
+  if (workers_.empty() || task_count < 2) {
+    for (size_t i = 0; i < task_count; i++)
+      task(i);
+    return;
+  }
+  JobCounter counter;
+  QueuedJob queued_job;
+  queued_job.function = &JobSystem::RunRange<IndexedTask>;
+  queued_job.counter = &counter;
+  queued_job.begin = 0;
+  queued_job.end = task_count;
+  const IndexedTask* task_pointer = &task;
+  std::memcpy(queued_job.storage, &task_pointer, sizeof(task_pointer));
+  RunRange<IndexedTask>(*this, queued_job);
+  Wait(counter);
+}
+
+template <typename Callable>
+void JobSystem::RunCallable(JobSystem&, const QueuedJob& job) {
+  (*reinterpret_cast<const Callable*>(job.storage))();
+}
+
+// Submits the upper halves of the range for as long as there is room in the
+// queue, then runs what is left
+template <typename IndexedTask>
+void JobSystem::RunRange(JobSystem& job_system, const QueuedJob& job) {
+  const IndexedTask* task;
+  std::memcpy(&task, job.storage, sizeof(task));
+  size_t begin = job.begin;
+  size_t end = job.end;
+  while (end - begin > 1) {
+    QueuedJob upper_half = job;
+    upper_half.begin = begin + (end - begin) / 2;
+    upper_half.end = end;
+    if (!job_system.TryEnqueue(upper_half, *job.counter))
+      break;
+    end = upper_half.begin;
+  }
+  for (size_t i = begin; i < end; i++)
+    (*task)(i);
+}
+
+// Jobs with dependencies between them. A task is added after the tasks it
+// depends on, so the graph has no cycles; it is submitted as soon as the last
+// of them has finished. A graph can be run any number of times.
+class TaskGraph {
+ public:
+  size_t AddTask(Job job, const std::vector<size_t>& dependencies = {});
+  void Run(JobSystem& job_system);
+
+ private:
+  struct TaskNode {
+    Job job;
+    std::vector<size_t> dependents;
+    size_t dependency_count;
+    std::atomic<size_t> unfinished_dependencies;
+  };
+
+  void SubmitTask(size_t task_index,
+                  JobSystem& job_system,
+                  JobCounter& counter);
+
+  // Nodes are never moved, as they hold atomics
+  std::deque<TaskNode> tasks_;
+};
+
+#endif
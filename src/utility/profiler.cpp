@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "utility/benchmark.hpp"
+#include "utility/profiler.hpp"
+
+namespace {
+thread_local ProfilerThreadBuffer* thread_buffer = nullptr;
+thread_local uint32_t thread_zone_depth = 0;
+
+int64_t GetSteadyClockNanoseconds() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+}  // namespace
+
+void ProfilerThreadBuffer::Append(const ZoneRecord& record) noexcept {
+  size_t written = written_.load(std::memory_order_relaxed);
+  records_[written % kProfilerRingSize] = record;
+  written_.store(written + 1, std::memory_order_release);
+}
+
+Profiler& Profiler::GetInstance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler()
+    : epoch_ns_(::GetSteadyClockNanoseconds()),
+      frame_count_(0),
+      dropped_records_(0),
+      capture_frames_left_(0),
+      trace_thread_count_(0) {}
+
+// Buffers outlive their threads, so that zones of finished workers can still
+// be collected
+ProfilerThreadBuffer& Profiler::GetThreadBuffer() {
+  if (!::thread_buffer) {
+    std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+    thread_buffers_.push_back(std::make_unique<ProfilerThreadBuffer>());
+    ::thread_buffer = thread_buffers_.back().get();
+  }
+  return *::thread_buffer;
+}
+
+int64_t Profiler::GetTimestamp() const noexcept {
+  return ::GetSteadyClockNanoseconds() - epoch_ns_;
+}
+
+void Profiler::EndFrame() {
+  for (ZoneHistory& zone : zones_) {
+    zone.frame_ms = 0;
+    zone.frame_calls = 0;
+  }
+  std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+  for (size_t i = 0; i < thread_buffers_.size(); i++)
+    dropped_records_ +=
+        thread_buffers_[i]->Consume([this, i](const ZoneRecord& record) {
+          ZoneHistory& zone = GetZoneHistory(record);
+          zone.frame_ms += (record.end_ns - record.start_ns) / 1000000.0f;
+          zone.frame_calls++;
+          if (capture_frames_left_)
+            trace_events_.push_back({record, i});
+        });
+  if (capture_frames_left_) {
+    trace_frame_ends_ns_.push_back(GetTimestamp());
+    trace_thread_count_ = thread_buffers_.size();
+    capture_frames_left_--;
+  }
+  for (ZoneHistory& zone : zones_) {
+    zone.frame_ms_history[frame_count_ % kProfilerHistoryFrames] =
+        zone.frame_ms;
+    zone.total_calls += zone.frame_calls;
+  }
+  frame_count_++;
+}
+
+// Forgets the statistics; records that have not been collected yet are
+// discarded as well
+void Profiler::Reset() {
+  std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+  for (std::unique_ptr<ProfilerThreadBuffer>& buffer : thread_buffers_)
+    buffer->Consume([](const ZoneRecord&) {});
+  zones_.clear();
+  zone_indices_.clear();
+  frame_count_ = 0;
+  dropped_records_ = 0;
+  capture_frames_left_ = 0;
+  trace_events_.clear();
+  trace_frame_ends_ns_.clear();
+  trace_thread_count_ = 0;
+}
+
+// Zones are listed in the order in which they first started, so that nested
+// zones follow their parents
+std::vector<ZoneStatistics> Profiler::GetZoneStatistics() const {
+  std::vector<const ZoneHistory*> zones;
+  for (const ZoneHistory& zone : zones_)
+    zones.push_back(&zone);
+  std::sort(zones.begin(), zones.end(),
+            [](const ZoneHistory* lhs, const ZoneHistory* rhs) {
+              if (lhs->first_start_ns != rhs->first_start_ns)
+                return lhs->first_start_ns < rhs->first_start_ns;
+              return lhs->depth < rhs->depth;
+            });
+  std::vector<ZoneStatistics> statistics;
+  size_t history_length = std::min(frame_count_, kProfilerHistoryFrames);
+  for (const ZoneHistory* zone_pointer : zones) {
+    const ZoneHistory& zone = *zone_pointer;
+    std::vector<float> frame_ms(zone.frame_ms_history.begin(),
+                                zone.frame_ms_history.begin() + history_length);
+    float sum = 0;
+    for (float ms : frame_ms)
+      sum += ms;
+    statistics.push_back(
+        {zone.name, zone.depth,
+         frame_count_ ? static_cast<float>(zone.total_calls) / frame_count_
+                      : 0,
+         history_length ? sum / history_length : 0,
+         ::GetPercentile(frame_ms, 50), ::GetPercentile(frame_ms, 95),
+         ::GetPercentile(frame_ms, 99)});
+  }
+  return statistics;
+}
+
+size_t Profiler::GetDroppedRecordCount() const noexcept {
+  return dropped_records_;
+}
+
+void Profiler::PrintZoneStatistics() const {
+  std::cout << std::left << std::setw(32) << "Zone" << std::right
+            << std::setw(10) << "calls" << std::setw(10) << "mean"
+            << std::setw(10) << "p50" << std::setw(10) << "p95"
+            << std::setw(10) << "p99" << " (ms per frame)\n";
+  for (const ZoneStatistics& zone : GetZoneStatistics())
+    std::cout << std::left << std::setw(32)
+              << std::string(2 * zone.depth, ' ') + zone.name << std::right
+              << std::fixed << std::setprecision(3) << std::setw(10)
+              << zone.calls_per_frame << std::setw(10) << zone.mean_ms
+              << std::setw(10) << zone.p50_ms << std::setw(10) << zone.p95_ms
+              << std::setw(10) << zone.p99_ms << "\n";
+  if (dropped_records_)
+    std::cout << dropped_records_ << " zone records were dropped.\n";
+}
+
+// Records that are still in the thread buffers belong to the first captured
+// frame
+void Profiler::StartCapture(size_t frame_count) {
+  trace_events_.clear();
+  trace_frame_ends_ns_.clear();
+  capture_frames_left_ = frame_count;
+}
+
+bool Profiler::IsCapturing() const noexcept {
+  return capture_frames_left_ > 0;
+}
+
+// Chrome trace event format, which chrome://tracing and Perfetto load. Zones
+// are complete events in microseconds; frame ends are global instant events.
+void Profiler::WriteTraceEvents(std::ostream& output_stream) const {
+  output_stream << std::fixed << std::setprecision(3)
+                << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+                << "  {\"name\": \"process_name\", \"ph\": \"M\", "
+                << "\"pid\": 1, \"args\": {\"name\": \"renderer\"}}";
+  for (size_t i = 0; i < trace_thread_count_; i++)
+    output_stream << ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", "
+                  << "\"pid\": 1, \"tid\": " << i
+                  << ", \"args\": {\"name\": \"Thread " << i << "\"}}";
+  for (const TraceEvent& event : trace_events_)
+    output_stream << ",\n  {\"name\": \"" << event.record.name
+                  << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                  << event.thread_index
+                  << ", \"ts\": " << event.record.start_ns / 1000.0
+                  << ", \"dur\": "
+                  << (event.record.end_ns - event.record.start_ns) / 1000.0
+                  << "}";
+  for (size_t frame = 0; frame < trace_frame_ends_ns_.size(); frame++)
+    output_stream << ",\n  {\"name\": \"Frame " << frame
+                  << "\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 1, "
+                  << "\"tid\": 0, \"ts\": "
+                  << trace_frame_ends_ns_[frame] / 1000.0 << "}";
+  output_stream << "\n]}\n";
+}
+
+// Zones are identified by name, so that one name used at several places adds
+// up; the depth is the one of its first occurrence
+Profiler::ZoneHistory& Profiler::GetZoneHistory(const ZoneRecord& record) {
+  auto it = zone_indices_.find(record.name);
+  if (it != zone_indices_.end()) {
+    ZoneHistory& zone = zones_[it->second];
+    zone.first_start_ns = std::min(zone.first_start_ns, record.start_ns);
+    return zone;
+  }
+  zone_indices_.emplace(record.name, zones_.size());
+  zones_.push_back({record.name, record.depth, record.start_ns, 0, 0, {}, 0});
+  return zones_.back();
+}
+
+ProfileZone::ProfileZone(const char* name) noexcept
+    : name_(name),
+      start_ns_(Profiler::GetInstance().GetTimestamp()),
+      depth_(::thread_zone_depth++) {}
+
+ProfileZone::~ProfileZone() {
+  ::thread_zone_depth--;
+  Profiler& profiler = Profiler::GetInstance();
+  profiler.GetThreadBuffer().Append(
+      {name_, start_ns_, profiler.GetTimestamp(), depth_});
+}
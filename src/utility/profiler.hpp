@@ -0,0 +1,143 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Scoped zone profiler. PROFILE_ZONE("name") times the rest of the enclosing
+// block; zones nest. Each thread appends finished zones to its own ring
+// buffer without locking, and Profiler::EndFrame folds them into rolling
+// per-zone statistics between frames, while no zone is open on any thread.
+// Without ENABLE_PROFILER (scons profiler=1) the macros compile to nothing.
+// A capture additionally keeps every record of the next frames, to be written
+// as Chrome trace events with one timeline per thread.
+
+constexpr size_t kProfilerRingSize = 1 << 14;
+constexpr size_t kProfilerHistoryFrames = 128;
+
+typedef struct ZoneRecord {
+  const char* name;
+  int64_t start_ns;
+  int64_t end_ns;
+  uint32_t depth;
+} ZoneRecord;
+
+// Times of one zone summed per frame, over the last kProfilerHistoryFrames
+typedef struct ZoneStatistics {
+  std::string name;
+  uint32_t depth;
+  float calls_per_frame;
+  float mean_ms;
+  float p50_ms;
+  float p95_ms;
+  float p99_ms;
+} ZoneStatistics;
+
+class ProfilerThreadBuffer {
+ public:
+  void Append(const ZoneRecord& record) noexcept;
+  // Invokes visit for each record appended since the previous call; records
+  // overwritten in the meantime are skipped and counted as dropped
+  template <typename Visitor>
+  size_t Consume(Visitor visit);
+
+ private:
+  std::array<ZoneRecord, kProfilerRingSize> records_;
+  std::atomic<size_t> written_{0};
+  size_t consumed_ = 0;
+};
+
+class Profiler {
+ public:
+  static Profiler& GetInstance();
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+  ProfilerThreadBuffer& GetThreadBuffer();
+  int64_t GetTimestamp() const noexcept;
+  void EndFrame();
+  void Reset();
+  std::vector<ZoneStatistics> GetZoneStatistics() const;
+  size_t GetDroppedRecordCount() const noexcept;
+  void PrintZoneStatistics() const;
+  void StartCapture(size_t frame_count);
+  bool IsCapturing() const noexcept;
+  void WriteTraceEvents(std::ostream& output_stream) const;
+
+ private:
+  Profiler();
+
+  typedef struct ZoneHistory {
+    std::string name;
+    uint32_t depth;
+    int64_t first_start_ns;
+    float frame_ms;
+    size_t frame_calls;
+    std::array<float, kProfilerHistoryFrames> frame_ms_history;
+    size_t total_calls;
+  } ZoneHistory;
+
+  typedef struct TraceEvent {
+    ZoneRecord record;
+    size_t thread_index;
+  } TraceEvent;
+
+  ZoneHistory& GetZoneHistory(const ZoneRecord& record);
+
+  const int64_t epoch_ns_;
+  std::mutex thread_buffers_mutex_;
+  std::vector<std::unique_ptr<ProfilerThreadBuffer>> thread_buffers_;
+  std::vector<ZoneHistory> zones_;
+  std::unordered_map<std::string, size_t> zone_indices_;
+  size_t frame_count_;
+  size_t dropped_records_;
+  size_t capture_frames_left_;
+  std::vector<TraceEvent> trace_events_;
+  std::vector<int64_t> trace_frame_ends_ns_;
+  size_t trace_thread_count_;
+};
+
+class ProfileZone {
+ public:
+  explicit ProfileZone(const char* name) noexcept;
+  ~ProfileZone();
+  ProfileZone(const ProfileZone&) = delete;
+  ProfileZone& operator=(const ProfileZone&) = delete;
+
+ private:
+  const char* name_;
+  int64_t start_ns_;
+  uint32_t depth_;
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+#define PROFILE_ZONE(name) \
+  ProfileZone PROFILE_CONCATENATE(profile_zone_, __LINE__)(name)
+#define PROFILE_END_FRAME() Profiler::GetInstance().EndFrame()
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_END_FRAME()
+#endif
+
+template <typename Visitor>
+size_t ProfilerThreadBuffer::Consume(Visitor visit) {
+  size_t written = written_.load(std::memory_order_acquire);
+  size_t dropped = 0;
+  if (written - consumed_ > kProfilerRingSize) {
+    dropped = written - consumed_ - kProfilerRingSize;
+    consumed_ = written - kProfilerRingSize;
+  }
+  for (; consumed_ < written; consumed_++)
+    visit(records_[consumed_ % kProfilerRingSize]);
+  return dropped;
+}
+
+#endif
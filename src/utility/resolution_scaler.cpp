@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <cmath>
+
+#include "geometry/common.hpp"
+#include "utility/resolution_scaler.hpp"
+
+ResolutionScaler::ResolutionScaler(float frame_budget_ms) noexcept
+    : frame_budget_ms_(frame_budget_ms),
+      scale_steps_(kRenderScaleSteps),
+      smoothed_frame_ms_(0),
+      frames_since_change_(0) {}
+
+// Returns whether the scale changed. Frame times are only compared with the
+// budget after the first kRenderScaleSettleFrames frames at a scale, so that
+// buffer reallocations and the smoothing lag do not trigger another change.
+bool ResolutionScaler::AddFrame(float frame_ms) noexcept {
+  if (frames_since_change_++)
+    smoothed_frame_ms_ += kFrameTimeSmoothing * (frame_ms - smoothed_frame_ms_);
+  else
+    smoothed_frame_ms_ = frame_ms;
+  if (frames_since_change_ < kRenderScaleSettleFrames)
+    return false;
+  uint16_t scale_steps = scale_steps_;
+  if (smoothed_frame_ms_ > frame_budget_ms_) {
+    float fitting_steps =
+        scale_steps_ * std::sqrt(frame_budget_ms_ / smoothed_frame_ms_);
+    scale_steps = std::max<int>(kMinRenderScaleSteps,
+                                std::min<int>(std::floor(fitting_steps),
+                                              scale_steps_ - 1));
+  } else if (scale_steps_ < kRenderScaleSteps) {
+    float growth = static_cast<float>(scale_steps_ + 1) / scale_steps_;
+    if (smoothed_frame_ms_ * growth * growth <
+        frame_budget_ms_ * kRenderScaleHeadroom)
+      scale_steps++;
+  }
+  if (scale_steps == scale_steps_)
+    return false;
+  scale_steps_ = scale_steps;
+  frames_since_change_ = 0;
+  return true;
+}
+
+float ResolutionScaler::GetScale() const noexcept {
+  return static_cast<float>(scale_steps_) / kRenderScaleSteps;
+}
+
+uint16_t ResolutionScaler::GetScaledSize(uint16_t size) const noexcept {
+  return std::max(1, size * scale_steps_ / kRenderScaleSteps);
+}
@@ -0,0 +1,27 @@
+#ifndef RESOLUTION_SCALER_HPP
+#define RESOLUTION_SCALER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Chooses the fraction of the window size to render at, so that the frame
+// time stays within a budget. The scale drops as soon as the smoothed frame
+// time exceeds the budget, and grows one step at a time while the frame time
+// predicted for the next step still leaves some headroom. The cost of a frame
+// is assumed to grow with the pixel count, i.e. with the squared scale.
+class ResolutionScaler {
+ public:
+  ResolutionScaler() = delete;
+  ResolutionScaler(float frame_budget_ms) noexcept;
+  bool AddFrame(float frame_ms) noexcept;
+  float GetScale() const noexcept;
+  uint16_t GetScaledSize(uint16_t size) const noexcept;
+
+ private:
+  float frame_budget_ms_;
+  uint16_t scale_steps_;
+  float smoothed_frame_ms_;
+  size_t frames_since_change_;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+// Thin wrappers over the widest float vector available at compile time.
+// Comparisons return all-ones lanes for true, so their results can be used
+// directly as bit masks with SimdAnd/SimdOr/SimdSelect.
+
+#if defined(__AVX2__)
+
+typedef __m256 FloatBlock;
+constexpr size_t kSimdWidth = 8;
+
+inline FloatBlock SimdBroadcast(float value) noexcept {
+  return _mm256_set1_ps(value);
+}
+inline FloatBlock SimdBroadcastBits(uint32_t bits) noexcept {
+  return _mm256_castsi256_ps(_mm256_set1_epi32(bits));
+}
+inline FloatBlock SimdLaneOffsets() noexcept {
+  return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+}
+inline FloatBlock SimdLoad(const void* source) noexcept {
+  return _mm256_loadu_ps(static_cast<const float*>(source));
+}
+inline void SimdStore(void* destination, FloatBlock block) noexcept {
+  _mm256_storeu_ps(static_cast<float*>(destination), block);
+}
+inline FloatBlock SimdAdd(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm256_add_ps(lhs, rhs);
+}
+inline FloatBlock SimdSubtract(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm256_sub_ps(lhs, rhs);
+}
+inline FloatBlock SimdMultiply(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm256_mul_ps(lhs, rhs);
+}
+inline FloatBlock SimdMax(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm256_max_ps(lhs, rhs);
+}
+inline FloatBlock SimdLess(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm256_cmp_ps(lhs, rhs, _CMP_LT_OQ);
+}
+inline FloatBlock SimdLessEqual(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm256_cmp_ps(lhs, rhs, _CMP_LE_OQ);
+}
+inline FloatBlock SimdGreaterEqual(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm256_cmp_ps(lhs, rhs, _CMP_GE_OQ);
+}
+inline FloatBlock SimdEqual(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm256_cmp_ps(lhs, rhs, _CMP_EQ_OQ);
+}
+inline FloatBlock SimdAnd(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm256_and_ps(lhs, rhs);
+}
+inline FloatBlock SimdOr(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm256_or_ps(lhs, rhs);
+}
+inline FloatBlock SimdSelect(FloatBlock mask,
+                             FloatBlock if_true,
+                             FloatBlock if_false) noexcept {
+  return _mm256_blendv_ps(if_false, if_true, mask);
+}
+inline int SimdMoveMask(FloatBlock mask) noexcept {
+  return _mm256_movemask_ps(mask);
+}
+
+#elif defined(__SSE2__)
+
+typedef __m128 FloatBlock;
+constexpr size_t kSimdWidth = 4;
+
+inline FloatBlock SimdBroadcast(float value) noexcept {
+  return _mm_set1_ps(value);
+}
+inline FloatBlock SimdBroadcastBits(uint32_t bits) noexcept {
+  return _mm_castsi128_ps(_mm_set1_epi32(bits));
+}
+inline FloatBlock SimdLaneOffsets() noexcept {
+  return _mm_setr_ps(0, 1, 2, 3);
+}
+inline FloatBlock SimdLoad(const void* source) noexcept {
+  return _mm_loadu_ps(static_cast<const float*>(source));
+}
+inline void SimdStore(void* destination, FloatBlock block) noexcept {
+  _mm_storeu_ps(static_cast<float*>(destination), block);
+}
+inline FloatBlock SimdAdd(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm_add_ps(lhs, rhs);
+}
+inline FloatBlock SimdSubtract(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm_sub_ps(lhs, rhs);
+}
+inline FloatBlock SimdMultiply(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm_mul_ps(lhs, rhs);
+}
+inline FloatBlock SimdMax(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm_max_ps(lhs, rhs);
+}
+inline FloatBlock SimdLess(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm_cmplt_ps(lhs, rhs);
+}
+inline FloatBlock SimdLessEqual(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm_cmple_ps(lhs, rhs);
+}
+inline FloatBlock SimdGreaterEqual(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm_cmpge_ps(lhs, rhs);
+}
+inline FloatBlock SimdEqual(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm_cmpeq_ps(lhs, rhs);
+}
+inline FloatBlock SimdAnd(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm_and_ps(lhs, rhs);
+}
+inline FloatBlock SimdOr(FloatBlock lhs, FloatBlock rhs) noexcept {
+  return _mm_or_ps(lhs, rhs);
+}
+inline FloatBlock SimdSelect(FloatBlock mask,
+                             FloatBlock if_true,
+                             FloatBlock if_false) noexcept {
+  return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+}
+inline int SimdMoveMask(FloatBlock mask) noexcept {
+  return _mm_movemask_ps(mask);
+}
+
+#else
+#error "SIMD kernels require SSE2 or AVX2"
+#endif
+
+#endif